@@ -0,0 +1,183 @@
+#pragma once
+
+// Generated inputs for the benchmarks, the same seed always gives the same
+// corpus so runs can be compared.
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace losgodis::bench
+{
+
+enum class key_lengths
+{
+    short_keys,  // 3 - 10 bytes, like identifiers and keywords
+    medium_keys, // 20 - 60 bytes, like qualified names and json keys
+    long_keys,   // 100 - 300 bytes, like urls and sql text
+};
+
+inline const char* name(key_lengths lengths)
+{
+    switch (lengths)
+    {
+    case key_lengths::short_keys: return "short";
+    case key_lengths::medium_keys: return "medium";
+    case key_lengths::long_keys: return "long";
+    }
+    return "";
+}
+
+// count distinct identifier like strings
+inline std::vector<std::string> make_keys(size_t count, key_lengths lengths, uint32_t seed = 1)
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+
+    size_t min = 3, max = 10;
+    if (lengths == key_lengths::medium_keys)
+    {
+        min = 20, max = 60;
+    }
+    else if (lengths == key_lengths::long_keys)
+    {
+        min = 100, max = 300;
+    }
+
+    std::mt19937 rng{ seed };
+    std::uniform_int_distribution<size_t> length{ min, max };
+    std::uniform_int_distribution<size_t> letter{ 0, sizeof(chars) - 2 };
+
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string key(length(rng), ' ');
+        for (auto& c : key)
+        {
+            c = chars[letter(rng)];
+        }
+        // keep them distinct without changing the length distribution much
+        auto n = i;
+        for (size_t j = 0; j < key.size() && n != 0; ++j, n /= 62)
+        {
+            key[j] = chars[n % 62];
+        }
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+enum class text
+{
+    ascii,   // english like text
+    latin,   // mostly ascii with 2 byte accented letters
+    cjk,     // mostly 3 byte codepoints
+    emoji,   // ascii mixed with 4 byte codepoints
+    invalid, // ascii with a broken sequence at the end, so the whole text is read
+};
+
+inline const char* name(text kind)
+{
+    switch (kind)
+    {
+    case text::ascii: return "ascii";
+    case text::latin: return "latin";
+    case text::cjk: return "cjk";
+    case text::emoji: return "emoji";
+    case text::invalid: return "invalid";
+    }
+    return "";
+}
+
+inline void append_codepoint(std::string& out, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800)
+    {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// about size bytes of text, always whole codepoints
+inline std::string make_text(text kind, size_t size, uint32_t seed = 1)
+{
+    static const char* const words[] = { "the", "of", "and", "pool", "string", "validate", "index", "a", "to", "in", "page", "hash" };
+    static const uint32_t latin[] = { 0xE9, 0xE8, 0xE0, 0xFC, 0xF6, 0xE4, 0xE7, 0xF1, 0xDF, 0xF8, 0xE5, 0xED };
+
+    std::mt19937 rng{ seed };
+    std::string out;
+    out.reserve(size + 8);
+    while (out.size() < size)
+    {
+        const auto r = rng();
+        switch (kind)
+        {
+        case text::ascii:
+        case text::invalid:
+            out += words[r % 12];
+            out += (r >> 8) % 16 == 0 ? ".\n" : " ";
+            break;
+        case text::latin:
+            if ((r >> 8) % 8 == 0)
+            {
+                append_codepoint(out, latin[r % 12]);
+            }
+            else
+            {
+                out += static_cast<char>('a' + r % 26);
+            }
+            if ((r >> 12) % 6 == 0)
+            {
+                out += ' ';
+            }
+            break;
+        case text::cjk:
+            if ((r >> 8) % 10 == 0)
+            {
+                out += (r >> 12) % 2 == 0 ? "\xE3\x80\x82" : " "; // ideographic full stop
+            }
+            else
+            {
+                append_codepoint(out, 0x4E00 + r % 0x5200);
+            }
+            break;
+        case text::emoji:
+            if ((r >> 8) % 4 == 0)
+            {
+                append_codepoint(out, 0x1F600 + r % 0x50);
+            }
+            else
+            {
+                out += words[r % 12];
+                out += ' ';
+            }
+            break;
+        }
+    }
+    if (kind == text::invalid)
+    {
+        out += "\xC3\x28"; // lead byte followed by ascii
+    }
+    return out;
+}
+
+} // namespace losgodis::bench
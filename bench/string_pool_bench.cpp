@@ -0,0 +1,393 @@
+
+#include "corpus.hpp"
+
+#include "losgodis/concurrent_string_pool.hpp"
+#include "losgodis/dynamic_pool.hpp"
+#include "losgodis/static_string_table.hpp"
+#include "losgodis/string_pool.hpp"
+#include "losgodis/symbol_pool.hpp"
+#include "losgodis/thread_cache.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+using namespace losgodis;
+using namespace losgodis::bench;
+
+namespace
+{
+
+// The same interning interface for every pool, get returns something that
+// identifies the pooled string.
+struct string_pool_adapter
+{
+    string_pool pool;
+
+    fixed_string get(std::string_view s) { return pool.get_string(s); }
+};
+
+struct concurrent_string_pool_adapter
+{
+    concurrent_string_pool pool;
+
+    fixed_string get(std::string_view s) { return pool.get_string(s); }
+};
+
+struct thread_cache_adapter
+{
+    concurrent_string_pool               pool;
+    thread_cache<concurrent_string_pool> cache{ pool };
+
+    fixed_string get(std::string_view s) { return cache.get_string(s); }
+};
+
+struct symbol_pool_adapter
+{
+    symbol_pool pool;
+
+    symbol get(std::string_view s) { return pool.get_symbol(s); }
+};
+
+struct dynamic_pool_adapter
+{
+    dynamic_pool pool;
+
+    pooled_string get(std::string_view s) { return pool.get_string(s); }
+};
+
+// what string_pool replaces, without heterogeneous lookup in C++17 every
+// lookup makes a std::string
+struct unordered_set_adapter
+{
+    std::unordered_set<std::string> set;
+
+    const std::string* get(std::string_view s) { return &*set.emplace(s).first; }
+};
+
+// keys in a random order so the lookups are not in insertion order
+std::vector<std::string> lookup_order(const std::vector<std::string>& keys)
+{
+    auto order = keys;
+    std::shuffle(order.begin(), order.end(), std::mt19937{ 2 });
+    return order;
+}
+
+// range(0) is the pool size, range(1) the key_lengths
+template <class Pool>
+void get_string_hit(benchmark::State& state)
+{
+    const auto lengths = static_cast<key_lengths>(state.range(1));
+    const auto keys = make_keys(static_cast<size_t>(state.range(0)), lengths);
+    const auto order = lookup_order(keys);
+
+    Pool pool;
+    for (const auto& key : keys)
+    {
+        pool.get(key);
+    }
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(pool.get(order[i]));
+        i = i + 1 < order.size() ? i + 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(name(lengths));
+}
+
+// fills an empty pool, range(0) is the number of strings
+template <class Pool>
+void get_string_miss(benchmark::State& state)
+{
+    const auto lengths = static_cast<key_lengths>(state.range(1));
+    const auto keys = make_keys(static_cast<size_t>(state.range(0)), lengths);
+
+    for (auto _ : state)
+    {
+        Pool pool;
+        for (const auto& key : keys)
+        {
+            benchmark::DoNotOptimize(pool.get(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(keys.size()));
+    state.SetLabel(name(lengths));
+}
+
+void pool_args(benchmark::internal::Benchmark* b)
+{
+    for (const auto lengths : { key_lengths::short_keys, key_lengths::medium_keys, key_lengths::long_keys })
+    {
+        for (const auto size : { 1 << 10, 1 << 14, 1 << 18, 1 << 20 })
+        {
+            b->Args({ size, static_cast<int64_t>(lengths) });
+        }
+    }
+}
+
+void miss_args(benchmark::internal::Benchmark* b)
+{
+    for (const auto lengths : { key_lengths::short_keys, key_lengths::medium_keys, key_lengths::long_keys })
+    {
+        for (const auto size : { 1 << 10, 1 << 16 })
+        {
+            b->Args({ size, static_cast<int64_t>(lengths) });
+        }
+    }
+}
+
+BENCHMARK_TEMPLATE(get_string_hit, string_pool_adapter)->Apply(pool_args);
+BENCHMARK_TEMPLATE(get_string_hit, concurrent_string_pool_adapter)->Apply(pool_args);
+BENCHMARK_TEMPLATE(get_string_hit, thread_cache_adapter)->Apply(pool_args);
+BENCHMARK_TEMPLATE(get_string_hit, symbol_pool_adapter)->Apply(pool_args);
+BENCHMARK_TEMPLATE(get_string_hit, dynamic_pool_adapter)->Apply(pool_args);
+BENCHMARK_TEMPLATE(get_string_hit, unordered_set_adapter)->Apply(pool_args);
+
+BENCHMARK_TEMPLATE(get_string_miss, string_pool_adapter)->Apply(miss_args);
+BENCHMARK_TEMPLATE(get_string_miss, concurrent_string_pool_adapter)->Apply(miss_args);
+BENCHMARK_TEMPLATE(get_string_miss, symbol_pool_adapter)->Apply(miss_args);
+BENCHMARK_TEMPLATE(get_string_miss, dynamic_pool_adapter)->Apply(miss_args);
+BENCHMARK_TEMPLATE(get_string_miss, unordered_set_adapter)->Apply(miss_args);
+
+// A typical keyword list, interned as literals or copied.
+constexpr string_literal keywords[] = {
+    "alignas"_key, "alignof"_key, "auto"_key, "bool"_key, "break"_key, "case"_key, "catch"_key, "char"_key,
+    "class"_key, "const"_key, "constexpr"_key, "continue"_key, "decltype"_key, "default"_key, "delete"_key, "do"_key,
+    "double"_key, "else"_key, "enum"_key, "explicit"_key, "extern"_key, "false"_key, "float"_key, "for"_key,
+    "friend"_key, "goto"_key, "if"_key, "inline"_key, "int"_key, "long"_key, "mutable"_key, "namespace"_key,
+    "new"_key, "noexcept"_key, "nullptr"_key, "operator"_key, "private"_key, "protected"_key, "public"_key, "return"_key,
+    "short"_key, "signed"_key, "sizeof"_key, "static"_key, "struct"_key, "switch"_key, "template"_key, "this"_key,
+    "throw"_key, "true"_key, "try"_key, "typedef"_key, "typename"_key, "union"_key, "unsigned"_key, "using"_key,
+    "virtual"_key, "void"_key, "volatile"_key, "while"_key };
+
+void intern_literals(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        string_pool pool;
+        for (const auto& keyword : keywords)
+        {
+            benchmark::DoNotOptimize(pool.get_string(keyword));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(std::size(keywords)));
+}
+BENCHMARK(intern_literals);
+
+void intern_copies(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        string_pool pool;
+        for (const auto& keyword : keywords)
+        {
+            benchmark::DoNotOptimize(pool.get_string(keyword.key_.view()));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(std::size(keywords)));
+}
+BENCHMARK(intern_copies);
+
+constexpr auto keyword_table = make_static_string_table({
+    "alignas"_key, "alignof"_key, "auto"_key, "bool"_key, "break"_key, "case"_key, "catch"_key, "char"_key,
+    "class"_key, "const"_key, "constexpr"_key, "continue"_key, "decltype"_key, "default"_key, "delete"_key, "do"_key,
+    "double"_key, "else"_key, "enum"_key, "explicit"_key, "extern"_key, "false"_key, "float"_key, "for"_key,
+    "friend"_key, "goto"_key, "if"_key, "inline"_key, "int"_key, "long"_key, "mutable"_key, "namespace"_key,
+    "new"_key, "noexcept"_key, "nullptr"_key, "operator"_key, "private"_key, "protected"_key, "public"_key, "return"_key,
+    "short"_key, "signed"_key, "sizeof"_key, "static"_key, "struct"_key, "switch"_key, "template"_key, "this"_key,
+    "throw"_key, "true"_key, "try"_key, "typedef"_key, "typename"_key, "union"_key, "unsigned"_key, "using"_key,
+    "virtual"_key, "void"_key, "volatile"_key, "while"_key });
+
+// keyword lookups of runtime strings, half of them not keywords
+template <bool Static>
+void lookup_keywords(benchmark::State& state)
+{
+    std::vector<std::string> words;
+    for (const auto& keyword : keywords)
+    {
+        words.emplace_back(keyword.key_.view());
+        words.push_back(words.back() + "_");
+    }
+    std::shuffle(words.begin(), words.end(), std::mt19937{ 3 });
+
+    string_pool pool;
+    for (const auto& keyword : keywords)
+    {
+        pool.get_string(keyword);
+    }
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        const auto key = string_key{ words[i] };
+        if constexpr (Static)
+        {
+            benchmark::DoNotOptimize(keyword_table.index_of(key));
+        }
+        else
+        {
+            benchmark::DoNotOptimize(pool.get_string(key));
+        }
+        i = i + 1 < words.size() ? i + 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(lookup_keywords, false);
+BENCHMARK_TEMPLATE(lookup_keywords, true);
+
+// hits of medium keys in a pool of range(0) strings, validated first
+template <bool Fused>
+void get_validated_string(benchmark::State& state)
+{
+    const auto keys = make_keys(static_cast<size_t>(state.range(0)), key_lengths::medium_keys);
+    const auto order = lookup_order(keys);
+
+    string_pool pool;
+    for (const auto& key : keys)
+    {
+        pool.get_string(key);
+    }
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        const std::string_view key{ order[i] };
+        if constexpr (Fused)
+        {
+            benchmark::DoNotOptimize(pool.get_validated_string(key));
+        }
+        else
+        {
+            const auto result = utf8::validate({ key.data(), key.size() });
+            benchmark::DoNotOptimize(result);
+            benchmark::DoNotOptimize(pool.get_string(key));
+        }
+        i = i + 1 < order.size() ? i + 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(get_validated_string, false)->Arg(1 << 10)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(get_validated_string, true)->Arg(1 << 10)->Arg(1 << 20);
+
+// range(0) is the pool size, lookups of batches of 1024 keys
+template <bool Batch>
+void get_strings(benchmark::State& state)
+{
+    constexpr size_t batch_size = 1024;
+
+    const auto keys = make_keys(static_cast<size_t>(state.range(0)), key_lengths::medium_keys);
+    std::vector<string_key> batch;
+    for (const auto& key : lookup_order(keys))
+    {
+        batch.emplace_back(key);
+        if (batch.size() == batch_size)
+        {
+            break;
+        }
+    }
+
+    string_pool pool;
+    for (const auto& key : keys)
+    {
+        pool.get_string(key);
+    }
+
+    std::vector<fixed_string> out;
+    out.reserve(batch.size());
+    for (auto _ : state)
+    {
+        out.clear();
+        if constexpr (Batch)
+        {
+            pool.get_strings(batch.data(), batch.size(), out);
+        }
+        else
+        {
+            for (const auto& key : batch)
+            {
+                out.push_back(pool.get_string(key));
+            }
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch.size()));
+}
+BENCHMARK_TEMPLATE(get_strings, false)->Arg(1 << 14)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(get_strings, true)->Arg(1 << 14)->Arg(1 << 20);
+
+// range(0) is the pool size, batches of 1024 keys of which half are not in
+// the pool, looked up with find or find_many
+template <bool Batch>
+void find_strings(benchmark::State& state)
+{
+    constexpr size_t batch_size = 1024;
+
+    const auto keys = make_keys(static_cast<size_t>(state.range(0)) * 2, key_lengths::medium_keys);
+    std::vector<string_key> batch;
+    for (const auto& key : lookup_order(keys))
+    {
+        batch.emplace_back(key);
+        if (batch.size() == batch_size)
+        {
+            break;
+        }
+    }
+
+    string_pool pool;
+    for (size_t i = 0; i < keys.size() / 2; ++i)
+    {
+        pool.get_string(keys[i]);
+    }
+
+    std::vector<std::optional<fixed_string>> out;
+    out.reserve(batch.size());
+    for (auto _ : state)
+    {
+        out.clear();
+        if constexpr (Batch)
+        {
+            pool.find_many(batch.data(), batch.size(), out);
+        }
+        else
+        {
+            for (const auto& key : batch)
+            {
+                out.push_back(pool.find(key));
+            }
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch.size()));
+}
+BENCHMARK_TEMPLATE(find_strings, false)->Arg(1 << 14)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(find_strings, true)->Arg(1 << 14)->Arg(1 << 20);
+
+// the same lookups as get_string_hit in a frozen pool
+void find_frozen(benchmark::State& state)
+{
+    const auto lengths = static_cast<key_lengths>(state.range(1));
+    const auto keys = make_keys(static_cast<size_t>(state.range(0)), lengths);
+    const auto order = lookup_order(keys);
+
+    string_pool pool;
+    for (const auto& key : keys)
+    {
+        pool.get_string(key);
+    }
+    const auto frozen = pool.freeze();
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(frozen.find(order[i]));
+        i = i + 1 < order.size() ? i + 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(name(lengths));
+}
+BENCHMARK(find_frozen)->Apply(pool_args);
+
+} // namespace
@@ -0,0 +1,165 @@
+
+#include "corpus.hpp"
+
+#include "losgodis/utf8.hpp"
+#include "losgodis/utf8_transcode.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(LOSGODIS_BENCH_SIMDUTF)
+#include <simdutf.h>
+#endif
+
+using namespace losgodis;
+using namespace losgodis::bench;
+
+namespace
+{
+
+// range(0) is the text kind, range(1) the size in bytes
+template <bool Quick>
+void validate(benchmark::State& state)
+{
+    const auto kind = static_cast<text>(state.range(0));
+    const auto input = make_text(kind, static_cast<size_t>(state.range(1)));
+    const utf8::byte_range range{ input.data(), input.size() };
+
+    for (auto _ : state)
+    {
+        auto result = Quick ? utf8::validate_quick(range) : utf8::validate(range);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+    state.SetLabel(name(kind));
+}
+
+void text_args(benchmark::internal::Benchmark* b)
+{
+    for (const auto kind : { text::ascii, text::latin, text::cjk, text::emoji, text::invalid })
+    {
+        for (const auto size : { 64, 4096, 1 << 20 })
+        {
+            b->Args({ static_cast<int64_t>(kind), size });
+        }
+    }
+}
+
+BENCHMARK_TEMPLATE(validate, false)->Apply(text_args);
+BENCHMARK_TEMPLATE(validate, true)->Apply(text_args);
+
+void count_codepoints(benchmark::State& state)
+{
+    const auto kind = static_cast<text>(state.range(0));
+    const auto input = make_text(kind, static_cast<size_t>(state.range(1)));
+    const utf8::utf8_range range{ input.data(), input.size() };
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(utf8::count_codepoints(range));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+    state.SetLabel(name(kind));
+}
+BENCHMARK(count_codepoints)->Apply(text_args);
+
+// decodes 1 MiB of text with decode_to_utf32 or the iterator
+template <bool Bulk>
+void decode_utf32(benchmark::State& state)
+{
+    const auto kind = static_cast<text>(state.range(0));
+    const auto input = make_text(kind, 1 << 20);
+    const auto range = utf8::validate({ input.data(), input.size() }).range;
+    std::vector<utf8::codepoint_t> output(range.codepoint_count());
+
+    for (auto _ : state)
+    {
+        if constexpr (Bulk)
+        {
+            benchmark::DoNotOptimize(utf8::decode_to_utf32(range, output.data()));
+        }
+        else
+        {
+            auto out = output.data();
+            for (const auto codepoint : range)
+            {
+                *out++ = codepoint;
+            }
+            benchmark::DoNotOptimize(out);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(range.size()));
+    state.SetLabel(name(kind));
+}
+BENCHMARK_TEMPLATE(decode_utf32, false)->DenseRange(0, 3);
+BENCHMARK_TEMPLATE(decode_utf32, true)->DenseRange(0, 3);
+
+// codepoint at random positions in 1 MiB of cjk text
+template <bool Indexed>
+void codepoint_at(benchmark::State& state)
+{
+    const auto input = make_text(text::cjk, 1 << 20);
+    const auto range = utf8::validate({ input.data(), input.size() }).range;
+    const utf8::codepoint_index index{ range };
+
+    std::vector<size_t> positions;
+    for (size_t i = 0; i < 1024; ++i)
+    {
+        positions.push_back(i * 7919 % range.codepoint_count());
+    }
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        const auto n = positions[i++ % positions.size()];
+        benchmark::DoNotOptimize(Indexed ? index.at(n) : range.at(n));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(codepoint_at, false);
+BENCHMARK_TEMPLATE(codepoint_at, true);
+
+// 1 MiB of text fed in chunks of range(1) bytes, like reads from a socket
+void validate_stream(benchmark::State& state)
+{
+    const auto kind = static_cast<text>(state.range(0));
+    const auto chunk_size = static_cast<size_t>(state.range(1));
+    const auto input = make_text(kind, 1 << 20);
+
+    for (auto _ : state)
+    {
+        utf8::stream_validator validator;
+        for (size_t i = 0; i < input.size(); i += chunk_size)
+        {
+            validator.feed({ input.data() + i, std::min(chunk_size, input.size() - i) });
+        }
+        auto result = validator.finish();
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+    state.SetLabel(name(kind));
+}
+BENCHMARK(validate_stream)->ArgsProduct({ { static_cast<int64_t>(text::ascii), static_cast<int64_t>(text::cjk) }, { 1500, 65536 } });
+
+#if defined(LOSGODIS_BENCH_SIMDUTF)
+
+void simdutf_validate(benchmark::State& state)
+{
+    const auto kind = static_cast<text>(state.range(0));
+    const auto input = make_text(kind, static_cast<size_t>(state.range(1)));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(simdutf::validate_utf8_with_errors(input.data(), input.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+    state.SetLabel(name(kind));
+}
+BENCHMARK(simdutf_validate)->Apply(text_args);
+
+#endif
+
+} // namespace
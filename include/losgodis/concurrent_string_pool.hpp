@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+
+    concurrent_string_pool
+
+A string_pool that can be used from many threads at the same time. The index
+is split into shards by the high bits of the hash, each with its own lock and
+pages. Looking up a string that is already pooled does not take any lock, only
+adding a new string locks its shard. A string is only ever added once, so
+fixed_strings from the same pool can be compared by pointer across threads.
+
+*/
+
+#include "losgodis/string_pool.hpp"
+
+#include <memory>
+
+namespace losgodis
+{
+
+namespace detail
+{
+
+// The part of concurrent_string_pool that does not depend on the hash policy.
+class concurrent_string_pool_base
+{
+
+public:
+
+    concurrent_string_pool_base(const concurrent_string_pool_base&) = delete;
+    concurrent_string_pool_base& operator=(const concurrent_string_pool_base&) = delete;
+
+protected:
+
+    concurrent_string_pool_base();
+    ~concurrent_string_pool_base();
+
+    fixed_string get_string(std::string_view string, size_t hash);
+    fixed_string get_literal(std::string_view string, size_t hash); // special one that does not copy
+
+private:
+
+    struct shard;
+
+    shard& get_shard(size_t hash);
+
+    std::unique_ptr<shard[]> shards_;
+};
+
+} // namespace detail
+
+template <class Hash = default_hash>
+class basic_concurrent_string_pool : private detail::concurrent_string_pool_base
+{
+
+public:
+
+    using key_type = basic_string_key<Hash>;
+    using literal_type = basic_string_literal<Hash>;
+
+    basic_concurrent_string_pool() = default;
+    // put a bunch of literals in pool without copying string data
+    basic_concurrent_string_pool(std::initializer_list<literal_type> list)
+    {
+        for (const auto& literal : list)
+        {
+            get_string(literal);
+        }
+    }
+
+    fixed_string get_string(key_type string) { return concurrent_string_pool_base::get_string(string.view(), string.hash()); }
+    fixed_string get_string(literal_type string) { return get_literal(string.key_.view(), string.key_.hash()); } // special one that does not copy
+    fixed_string get_string(std::string_view string) { return get_string(key_type{ string }); }
+    fixed_string get_string(const std::string& string) { return get_string(key_type{ string }); }
+};
+
+using concurrent_string_pool = basic_concurrent_string_pool<>;
+
+} // namespace losgodis
+
+#if defined(LOSGODIS_HEADER_ONLY)
+#include "../../src/losgodis/concurrent_string_pool.cpp"
+#endif
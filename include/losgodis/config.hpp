@@ -0,0 +1,61 @@
+#pragma once
+
+/*
+
+    config
+
+Defining LOSGODIS_HEADER_ONLY makes the headers include the sources, so 
+nothing has to be linked and the compiler can inline all of it into the 
+caller. LOSGODIS_INLINE marks the definitions in the sources.
+
+
+    trace hooks
+
+Points where a tracer (perfetto, etw, usdt probes) can be called, they are 
+empty by default and the code is the same as without them. Define 
+LOSGODIS_TRACE_HEADER to a header, for example "my_trace.hpp", that defines 
+any of the macros below, it is included here. The header has to be the same 
+in every translation unit.
+
+LOSGODIS_TRACE_GET_STRING_BEGIN(string)     get_string is called
+LOSGODIS_TRACE_GET_STRING_HIT(string)       the string was in the pool
+LOSGODIS_TRACE_GET_STRING_MISS(string)      the string was added to the pool
+LOSGODIS_TRACE_PAGE_ALLOCATION(bytes)       a page, or a dedicated page for a 
+                                            big string, was allocated
+LOSGODIS_TRACE_VALIDATE_BEGIN(size)         utf8::validate or validate_quick
+LOSGODIS_TRACE_VALIDATE_END(size, error)    is called, and returns error
+
+string is a std::string_view. The get_string hooks are also called by the 
+string literal overloads and concurrent_string_pool, get_strings only calls 
+HIT for the keys found in its first pass, the others go through get_string.
+
+*/
+
+#if defined(LOSGODIS_HEADER_ONLY)
+#define LOSGODIS_INLINE inline
+#else
+#define LOSGODIS_INLINE
+#endif
+
+#if defined(LOSGODIS_TRACE_HEADER)
+#include LOSGODIS_TRACE_HEADER
+#endif
+
+#if !defined(LOSGODIS_TRACE_GET_STRING_BEGIN)
+#define LOSGODIS_TRACE_GET_STRING_BEGIN(string) ((void)0)
+#endif
+#if !defined(LOSGODIS_TRACE_GET_STRING_HIT)
+#define LOSGODIS_TRACE_GET_STRING_HIT(string) ((void)0)
+#endif
+#if !defined(LOSGODIS_TRACE_GET_STRING_MISS)
+#define LOSGODIS_TRACE_GET_STRING_MISS(string) ((void)0)
+#endif
+#if !defined(LOSGODIS_TRACE_PAGE_ALLOCATION)
+#define LOSGODIS_TRACE_PAGE_ALLOCATION(bytes) ((void)0)
+#endif
+#if !defined(LOSGODIS_TRACE_VALIDATE_BEGIN)
+#define LOSGODIS_TRACE_VALIDATE_BEGIN(size) ((void)0)
+#endif
+#if !defined(LOSGODIS_TRACE_VALIDATE_END)
+#define LOSGODIS_TRACE_VALIDATE_END(size, error) ((void)0)
+#endif
@@ -0,0 +1,215 @@
+#pragma once
+
+/*
+
+    dynamic_pool
+
+A string pool that strings can be removed from, for long running programs 
+where the pooled strings come and go. Strings are copied to pages like in 
+string_pool, a removed string leaves a hole in its page until compact copies 
+the live strings to new pages and frees the old ones. compact_step does the 
+same a few strings at a time, so lookups are never stopped for long. The ids 
+of removed strings are reused through a free list.
+
+
+    pooled_string
+
+A handle to a string in a dynamic_pool, an index and a generation counter. The 
+counter changes when the string is removed, so a handle to a removed string 
+is no longer valid, even if its index is reused. The string data can move 
+when the pool is compacted, so keep the handle and not the pointer from 
+c_str.
+
+*/
+
+#include "losgodis/string_pool.hpp"
+
+#include <cstdint>
+#include <optional>
+
+namespace losgodis
+{
+
+namespace detail
+{
+
+class dynamic_pool_base;
+
+} // namespace detail
+
+class pooled_string
+{
+
+public:
+
+    pooled_string() noexcept = default;
+
+    uint64_t id() const { return id_; }
+    uint32_t index() const { return static_cast<uint32_t>(id_); }
+    uint32_t counter() const { return static_cast<uint32_t>(id_ >> 32); }
+
+    // false for a default constructed handle or if the string has been removed
+    bool valid() const;
+
+    // the handle has to be valid
+    size_t           size() const;
+    const char*      c_str() const;
+    std::string_view view() const { return std::string_view{ c_str(), size() }; }
+    std::string      str() const { return std::string{ view() }; }
+
+    friend bool operator==(pooled_string a, pooled_string b) { return a.id_ == b.id_ && a.pool_ == b.pool_; }
+    friend bool operator!=(pooled_string a, pooled_string b) { return !(a == b); }
+
+private:
+
+    friend detail::dynamic_pool_base;
+
+    pooled_string(uint64_t id, const detail::dynamic_pool_base* pool) noexcept :id_{ id }, pool_{ pool } {}
+
+    uint64_t                         id_ = 0;
+    const detail::dynamic_pool_base* pool_ = nullptr;
+};
+
+namespace detail
+{
+
+// The part of dynamic_pool that does not depend on the hash policy.
+class dynamic_pool_base
+{
+
+public:
+
+    dynamic_pool_base(const dynamic_pool_base&) = delete;
+    dynamic_pool_base& operator=(const dynamic_pool_base&) = delete;
+
+    // the number of strings in the pool
+    size_t size() const { return size_; }
+    // bytes in pages that are not used by any string, while compacting also
+    // the copies made so far
+    size_t dead_bytes() const;
+
+    // copies the live strings to new pages, after it there are no dead bytes
+    void compact();
+    // copies at most max_strings strings to the new pages, returns true when
+    // the compaction is done, the first call starts it
+    bool compact_step(size_t max_strings);
+
+protected:
+
+    explicit dynamic_pool_base(std::pmr::memory_resource* resource);
+    ~dynamic_pool_base();
+
+    pooled_string get_string(std::string_view string, size_t hash);
+    pooled_string find(std::string_view string, size_t hash) const;
+    bool          remove_string(std::string_view string, size_t hash);
+    bool          remove_string(pooled_string string);
+
+private:
+
+    friend pooled_string;
+
+    static constexpr uint32_t no_entry = UINT32_MAX;
+
+    struct entry
+    {
+        const char* data; // nullptr if free
+        size_t      size;
+        size_t      hash;
+        uint32_t    counter;
+        uint32_t    next_free;
+    };
+
+    struct group
+    {
+        uint64_t control;
+        uint32_t slots[string_index::group_size];
+    };
+
+    const entry* get_entry(pooled_string string) const;
+    uint32_t*    find_slot(std::string_view string, size_t hash) const;
+    void         remove_slot(uint32_t* slot);
+    void         rehash(size_t group_count);
+
+    pooled_string handle(uint32_t index) const { return pooled_string{ (uint64_t{ entries_[index].counter } << 32) | index, this }; }
+
+    std::pmr::memory_resource*    resource_;
+    std::pmr::vector<entry>       entries_;
+    uint32_t                      first_free_ = no_entry;
+    group*                        groups_ = nullptr;
+    size_t                        group_count_ = 0;
+    size_t                        growth_left_ = 0;
+    size_t                        size_ = 0;
+    size_t                        live_bytes_ = 0; // null terminators included
+    page_allocator                pages_;
+    std::optional<page_allocator> new_pages_; // while compacting
+    size_t                        compact_next_ = 0;
+    size_t                        compact_end_ = 0; // entries_.size() when compaction started
+};
+
+} // namespace detail
+
+inline bool pooled_string::valid() const
+{
+    return pool_ != nullptr && pool_->get_entry(*this) != nullptr;
+}
+
+inline size_t pooled_string::size() const
+{
+    return pool_->get_entry(*this)->size;
+}
+
+inline const char* pooled_string::c_str() const
+{
+    return pool_->get_entry(*this)->data;
+}
+
+template <class Hash = default_hash>
+class basic_dynamic_pool : private detail::dynamic_pool_base
+{
+
+public:
+
+    using key_type = basic_string_key<Hash>;
+
+    basic_dynamic_pool() :basic_dynamic_pool{ std::pmr::get_default_resource() } {}
+    // pages, index and entries are allocated from resource, it has to outlive the pool
+    explicit basic_dynamic_pool(std::pmr::memory_resource* resource) :dynamic_pool_base{ resource } {}
+
+    pooled_string get_string(key_type string) { return dynamic_pool_base::get_string(string.view(), string.hash()); }
+    pooled_string get_string(std::string_view string) { return get_string(key_type{ string }); }
+    pooled_string get_string(const std::string& string) { return get_string(key_type{ string }); }
+
+    // an invalid handle if the string is not in the pool
+    pooled_string find(key_type string) const { return dynamic_pool_base::find(string.view(), string.hash()); }
+
+    // false if the string was not in the pool, all handles to it become invalid
+    bool remove_string(key_type string) { return dynamic_pool_base::remove_string(string.view(), string.hash()); }
+    bool remove_string(pooled_string string) { return dynamic_pool_base::remove_string(string); }
+
+    using dynamic_pool_base::compact;
+    using dynamic_pool_base::compact_step;
+    using dynamic_pool_base::dead_bytes;
+    using dynamic_pool_base::size;
+};
+
+using dynamic_pool = basic_dynamic_pool<>;
+
+} // namespace losgodis
+
+namespace std
+{
+
+template <>
+class hash<losgodis::pooled_string>
+{
+
+public:
+
+    size_t operator()(losgodis::pooled_string str) const { return std::hash<uint64_t>{}(str.id()); }
+};
+
+} // namespace std
+
+#if defined(LOSGODIS_HEADER_ONLY)
+#include "../../src/losgodis/dynamic_pool.cpp"
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+
+    mapped_file
+
+A read only memory mapping of a whole file, for example a string_pool 
+snapshot. The mapping is page aligned and stays valid until the mapped_file 
+is destroyed, throws std::system_error if the file can not be mapped.
+
+*/
+
+#include <cstddef>
+
+#include "losgodis/string_pool.hpp"
+
+namespace losgodis
+{
+
+class mapped_file
+{
+
+public:
+
+    mapped_file() noexcept = default;
+    explicit mapped_file(const char* path);
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+    ~mapped_file();
+
+    const void* data() const { return data_; }
+    size_t      size() const { return size_; }
+
+    string_pool_snapshot snapshot() const { return string_pool_snapshot{ data_, size_ }; }
+
+private:
+
+    void unmap() noexcept;
+
+    const void* data_ = nullptr;
+    size_t      size_ = 0;
+#if defined(_WIN32)
+    void*       mapping_ = nullptr;
+#endif
+};
+
+} // namespace losgodis
+
+#if defined(LOSGODIS_HEADER_ONLY)
+#include "../../src/losgodis/mapped_file.cpp"
+#endif
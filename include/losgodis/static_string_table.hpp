@@ -0,0 +1,240 @@
+#pragma once
+
+/*
+
+    static_string_table
+
+A fixed set of string literals with a perfect hash, built at compile time. 
+Looking up a string_key takes one probe, a string that is not in the set is 
+rejected after comparing the hash. Useful for keywords and known field names, 
+index_of gives the position in the list the table was made from so it can be 
+used in a switch. Made with make_static_string_table({ "if"_key, ... }), 
+duplicates do not compile.
+
+
+    static_string_pool
+
+A static_string_table in front of a string_pool. Strings in the table are 
+returned as the literals of the table, all other strings are added to the 
+pool, so every string still has one fixed_string.
+
+*/
+
+#include "losgodis/string_pool.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace losgodis
+{
+
+template <size_t N, class Hash>
+class basic_static_string_table
+{
+
+public:
+
+    static_assert(N > 0, "static_string_table needs at least one string");
+    static_assert(N < UINT32_MAX, "static_string_table is too big");
+
+    using key_type = basic_string_key<Hash>;
+    using literal_type = basic_string_literal<Hash>;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    constexpr explicit basic_static_string_table(const literal_type (&literals)[N]) :
+        basic_static_string_table{ literals, std::make_index_sequence<N>{} }
+    {
+    }
+
+    constexpr size_t size() const { return N; }
+
+    // position in the list the table was made from, npos if not in the table
+    constexpr size_t index_of(key_type key) const
+    {
+        const auto hash = key.hash();
+        const auto i = slots_[slot(hash, displacements_[bucket(hash)])];
+        if (i != 0 && hashes_[i - 1] == hash && strings_[i - 1].view() == key.view())
+        {
+            return i - 1;
+        }
+        return npos;
+    }
+
+    constexpr bool                contains(key_type key) const { return index_of(key) != npos; }
+    constexpr const fixed_string* find(key_type key) const
+    {
+        const auto i = index_of(key);
+        return i != npos ? &strings_[i] : nullptr;
+    }
+
+    constexpr fixed_string operator[](size_t i) const { return strings_[i]; }
+
+private:
+
+    // load at most 3/4, and about 3 strings per bucket
+    static constexpr size_t power_of_two(size_t n)
+    {
+        size_t p = 1;
+        while (p < n)
+        {
+            p *= 2;
+        }
+        return p;
+    }
+
+    static constexpr size_t slot_count = power_of_two(N + N / 3 + 1);
+    static constexpr size_t bucket_count = power_of_two((N + 2) / 3);
+    static constexpr size_t max_displacement = 1u << 20;
+
+    // The bucket picks the displacement, which is mixed with the hash to get
+    // the slot. The displacements are chosen bucket by bucket, biggest bucket
+    // first, so that no two strings get the same slot.
+    static constexpr size_t bucket(size_t hash) { return hash & (bucket_count - 1); }
+    static constexpr size_t slot(size_t hash, uint32_t displacement)
+    {
+        // + 1, hash_mix(hash, 0) is 0 for every hash
+        return static_cast<size_t>(detail::hash_mix(hash, (displacement + uint64_t{ 1 }) * 0x9E3779B97F4A7C15u)) & (slot_count - 1);
+    }
+
+    template <size_t... I>
+    constexpr basic_static_string_table(const literal_type (&literals)[N], std::index_sequence<I...>) :
+        strings_{ fixed_string{ literals[I].key_.view().data(), literals[I].key_.view().size() }... },
+        hashes_{ literals[I].key_.hash()... }
+    {
+        build();
+    }
+
+    constexpr void build()
+    {
+        // sort the strings by bucket
+        size_t bucket_start[bucket_count + 1] = {};
+        for (size_t i = 0; i < N; ++i)
+        {
+            bucket_start[bucket(hashes_[i]) + 1]++;
+        }
+        for (size_t b = 0; b < bucket_count; ++b)
+        {
+            bucket_start[b + 1] += bucket_start[b];
+        }
+        size_t fill[bucket_count] = {};
+        uint32_t by_bucket[N] = {};
+        for (size_t i = 0; i < N; ++i)
+        {
+            const auto b = bucket(hashes_[i]);
+            by_bucket[bucket_start[b] + fill[b]++] = static_cast<uint32_t>(i);
+        }
+
+        // biggest buckets first, they are the hardest to place
+        size_t order[bucket_count] = {};
+        for (size_t b = 0; b < bucket_count; ++b)
+        {
+            size_t j = b;
+            for (; j > 0 && fill[order[j - 1]] < fill[b]; --j)
+            {
+                order[j] = order[j - 1];
+            }
+            order[j] = b;
+        }
+
+        for (const auto b : order)
+        {
+            const auto first = bucket_start[b];
+            const auto last = bucket_start[b + 1];
+            for (auto i = first; i < last; ++i)
+            {
+                for (auto j = first; j < i; ++j)
+                {
+                    if (hashes_[by_bucket[i]] == hashes_[by_bucket[j]] && strings_[by_bucket[i]].view() == strings_[by_bucket[j]].view())
+                    {
+                        throw std::invalid_argument{ "losgodis: duplicate string in static_string_table" };
+                    }
+                }
+            }
+
+            for (uint32_t d = 0;; ++d)
+            {
+                if (d == max_displacement)
+                {
+                    throw std::invalid_argument{ "losgodis: could not build static_string_table" };
+                }
+
+                auto placed = first;
+                for (; placed < last; ++placed)
+                {
+                    const auto s = slot(hashes_[by_bucket[placed]], d);
+                    if (slots_[s] != 0)
+                    {
+                        break;
+                    }
+                    slots_[s] = by_bucket[placed] + 1;
+                }
+                if (placed == last)
+                {
+                    displacements_[b] = d;
+                    break;
+                }
+
+                // take back the slots of this try
+                for (auto i = first; i < placed; ++i)
+                {
+                    slots_[slot(hashes_[by_bucket[i]], d)] = 0;
+                }
+            }
+        }
+    }
+
+    fixed_string strings_[N];
+    size_t       hashes_[N];
+    uint32_t     slots_[slot_count] = {}; // index + 1, 0 is empty
+    uint32_t     displacements_[bucket_count] = {};
+};
+
+template <class Hash, size_t N>
+constexpr basic_static_string_table<N, Hash> make_static_string_table(const basic_string_literal<Hash> (&literals)[N])
+{
+    return basic_static_string_table<N, Hash>{ literals };
+}
+
+template <size_t N, class Hash = default_hash>
+class basic_static_string_pool
+{
+
+public:
+
+    using table_type = basic_static_string_table<N, Hash>;
+    using key_type = basic_string_key<Hash>;
+    using literal_type = basic_string_literal<Hash>;
+
+    explicit basic_static_string_pool(const table_type& table, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        table_{ table },
+        pool_{ resource }
+    {
+    }
+
+    fixed_string get_string(key_type string)
+    {
+        const auto str = table_.find(string);
+        return str != nullptr ? *str : pool_.get_string(string);
+    }
+    fixed_string get_string(literal_type string)
+    {
+        const auto str = table_.find(string.key_);
+        return str != nullptr ? *str : pool_.get_string(string);
+    }
+    fixed_string get_string(std::string_view string) { return get_string(key_type{ string }); }
+    fixed_string get_string(const std::string& string) { return get_string(key_type{ string }); }
+
+    const table_type&              table() const { return table_; }
+    const basic_string_pool<Hash>& pool() const { return pool_; }
+
+    pool_stats stats() const { return pool_.stats(); }
+
+private:
+
+    table_type              table_;
+    basic_string_pool<Hash> pool_;
+};
+
+} // namespace losgodis
@@ -14,6 +14,64 @@ pooled yet the memory of the literal will be used by the fixed_string,
 instead copying the data to the chunk/page.
 
 
+    pages
+
+The pages start at page_size and grow 16 times per page up to max_page_size, 
+both can be set per pool. Strings too big for a page get an allocation of 
+their own. Pages and index are allocated from a std::pmr::memory_resource, 
+for example a per request monotonic_buffer_resource. clear empties the pool 
+but keeps its pages and index, for a pool that is filled again batch after 
+batch.
+
+
+    index
+
+Strings of up to 15 bytes are also kept in the index slots, a hit on a short 
+string does not touch the page. A big index grows incrementally, so no single 
+get_string pays for moving all strings. Call reserve if the number of strings 
+is known up front. stats returns the sizes of the pool and the index.
+
+
+    batches and lookups
+
+get_strings pools a whole batch of keys and hides the cache misses by 
+prefetching the index for the upcoming keys. find and find_many only look 
+strings up, a miss is not added, for input such as user supplied tokens that 
+should not grow the pool. get_validated_string checks that the string is 
+valid utf8 before pooling it.
+
+
+    snapshot
+
+write_snapshot writes the strings and the hash index of a pool to a stream. 
+A pool made from a string_pool_snapshot, for example of a mapped_file, uses 
+that memory in place, nothing is copied or rehashed. The snapshot part is 
+read only, new strings are added to pages as usual. The memory has to be 8 
+byte aligned, outlive the pool, and the snapshot has to be written with the 
+same hash policy and byte order. The strings of a snapshot are stored in the 
+order of their index slots. The header and every index slot are checked when 
+the pool is made, a truncated or corrupt snapshot throws std::invalid_argument
+instead of reading outside the memory, the strings themselves are not read.
+
+
+    frozen_string_pool
+
+An immutable pool made by string_pool::freeze, for when the set of strings is 
+done growing. It is a snapshot in memory, the index and all strings are in one
+allocation, and it can only find strings, not add them. Nothing in it changes 
+so it can be shared between threads without locks. The strings are copies, 
+its fixed_strings are not equal to the ones of the pool it was made from.
+
+
+    merge
+
+string_pool::merge moves all strings of another pool with the same hash policy
+into the pool, for example pools filled by one thread each. The pages of the 
+other pool are taken over, not copied, so its fixed_strings stay valid. A 
+string that was in both pools keeps the fixed_string of the pool merged into. 
+The other pool is left empty, and its memory_resource has to outlive the pool.
+
+
     fixed_string
 
 A pooled string. Will be fixed in memory, hence the name. fixed_strings 
@@ -21,11 +79,28 @@ from the same pool can be checked for equality by comparing the data
 pointer. It has conversion operators for common string types.
 
 
+    hashed_string
+
+A fixed_string that also carries the hash of its string_key. It is hashed by 
+that instead of by the pointer, so containers of them can be rebuilt and the 
+string_key recreated without touching the string data. string_hash and 
+string_equal lets such containers be searched with a string_key directly.
+
+
     string_key
 
 Used to add string and do lookup in the pool.
 
 
+    hash policy
+
+The string_key, string_literal and pools are templates on a hash policy, a 
+type with a static constexpr function size_t hash(const char*, size_t). The 
+default is wyhash, fnv1a_hash is the simpler byte at a time hash. Keys are 
+only usable with pools of the same policy. The names without the basic_ 
+prefix use the default policy.
+
+
     string_literal
 
 Special string_key that will not be copied when added to the pool. Can be 
@@ -33,60 +108,452 @@ constructed with the string literal operator _key.
 
 */
 
-#include <array>
+#include "losgodis/config.hpp"
+#include "losgodis/utf8.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
 #include <string_view>
-#include <unordered_set>
+#include <vector>
 
 namespace losgodis
 {
 
-// Change if needed, needs to be atleast large enough to hold biggest string
+// Default size of the first and the biggest page in a pool
 constexpr size_t page_size = 4096;
+constexpr size_t max_page_size = 1024 * 1024;
+
+struct fnv1a_hash;
+struct wyhash;
+using default_hash = wyhash;
+
+template <class Hash = default_hash> class basic_string_key;
+template <class Hash = default_hash> class basic_string_literal;
+template <class Hash = default_hash> class basic_hashed_string;
+template <class Hash = default_hash> class basic_string_pool;
+template <class Hash = default_hash> class basic_frozen_string_pool;
+template <size_t N, class Hash = default_hash> class basic_static_string_table;
+
+using string_key = basic_string_key<>;
+using string_literal = basic_string_literal<>;
+using hashed_string = basic_hashed_string<>;
+using string_pool = basic_string_pool<>;
+using frozen_string_pool = basic_frozen_string_pool<>;
+
+// Sizes of a pool, the lookup counters are only counted if
+// LOSGODIS_STRING_POOL_STATS is defined, it has to be defined the same way in
+// every translation unit. They count the lookups in the index, a string found
+// in the snapshot of a pool is not counted.
+struct pool_stats
+{
+    size_t string_count = 0;
+    size_t string_bytes = 0; // without null terminators, literals included
+    size_t page_count = 0;
+    size_t page_bytes = 0;
+    size_t page_bytes_used = 0;
+    size_t index_capacity = 0;
+
+    size_t lookups = 0;
+    size_t hits = 0;
+    size_t probed_groups = 0; // groups of 8 slots looked at by all lookups
+    size_t max_probed_groups = 0; // by a single lookup
+
+    double page_fill_ratio() const { return page_bytes != 0 ? double(page_bytes_used) / double(page_bytes) : 0.0; }
+    double load_factor() const { return index_capacity != 0 ? double(string_count) / double(index_capacity) : 0.0; }
+    double hit_ratio() const { return lookups != 0 ? double(hits) / double(lookups) : 0.0; }
+    double average_probe_length() const { return lookups != 0 ? double(probed_groups) / double(lookups) : 0.0; }
+};
 
-class string_pool;
-class string_key;
-class string_literal;
+// Memory holding a snapshot written by write_snapshot
+struct string_pool_snapshot
+{
+    const void* data;
+    size_t      size;
+};
 
 namespace detail
 {
 
-// Simple constexpr hash, todo: add a way to override
+class string_pool_base;
+class frozen_string_pool_base;
+class concurrent_string_pool_base;
+class thread_cache_base;
+struct literal_access;
+
+// Hash::hash of a hash policy, for the non template parts of the pools
+using hash_function = size_t (*)(const char* data, size_t size);
+
+#if defined(__SIZEOF_INT128__)
+// __extension__ keeps -Wpedantic quiet about the non standard type
+__extension__ typedef unsigned __int128 uint128_t;
+#endif
+
+// 64 x 64 -> 128 bit multiply, returns the low bits in a and the high in b
+constexpr void multiply_128(uint64_t& a, uint64_t& b)
+{
+#if defined(__SIZEOF_INT128__)
+    const auto r = static_cast<uint128_t>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+#else
+    const uint64_t a_hi = a >> 32, a_lo = a & 0xFFFFFFFFu;
+    const uint64_t b_hi = b >> 32, b_lo = b & 0xFFFFFFFFu;
+    const uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+    a = (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+    b = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+}
+
+constexpr uint64_t hash_mix(uint64_t a, uint64_t b)
+{
+    multiply_128(a, b);
+    return a ^ b;
+}
+
+// Little endian reads that also work in constant expressions, compilers turn
+// them into plain loads.
+constexpr uint64_t read_u8(const char* p) { return static_cast<uint8_t>(*p); }
+
+constexpr uint64_t read_u32(const char* p)
+{
+    return read_u8(p) | (read_u8(p + 1) << 8) | (read_u8(p + 2) << 16) | (read_u8(p + 3) << 24);
+}
+
+constexpr uint64_t read_u64(const char* p)
+{
+    return read_u32(p) | (read_u32(p + 4) << 32);
+}
+
+} // namespace detail
+
+// Simple constexpr hash, one byte at a time
 // http://isthe.com/chongo/tech/comp/fnv/
-constexpr size_t hash(const char* data, size_t size)
+struct fnv1a_hash
 {
-    constexpr size_t prime = sizeof(size_t) == 8 ? 1099511628211 : 16777619;
-    constexpr size_t offset = sizeof(size_t) == 8 ? 14695981039346656037 : 2166136261;
+    static constexpr size_t hash(const char* data, size_t size)
+    {
+        constexpr size_t prime = sizeof(size_t) == 8 ? size_t(1099511628211u) : size_t(16777619u);
+        constexpr size_t offset = sizeof(size_t) == 8 ? size_t(14695981039346656037u) : size_t(2166136261u);
+
+        size_t hash = offset;
+        for (size_t i = 0; i < size; ++i)
+        {
+            auto b = static_cast<size_t>(static_cast<uint8_t>(*(data + i)));
+            hash ^= b;
+            hash *= prime;
+        }
+        return hash;
+    }
+};
 
-    size_t hash = offset;
-    for (size_t i = 0; i < size; ++i)
+// constexpr wyhash (final version 4), reads 8 or 16 bytes at a time
+// https://github.com/wangyi-fudan/wyhash
+struct wyhash
+{
+    static constexpr size_t hash(const char* data, size_t size)
     {
-        auto b = static_cast<size_t>(static_cast<uint8_t>(*(data + i)));
-        hash ^= b;
-        hash *= prime;
+        using namespace detail;
+
+        constexpr uint64_t secret[4] = { 0x2d358dccaa6c78a5u, 0x8bb84b93962eacc9u, 0x4b33a62ed433d4a3u, 0x4d5a2da51de1aa47u };
+
+        auto p = data;
+        uint64_t seed = hash_mix(secret[0], secret[1]);
+        uint64_t a = 0;
+        uint64_t b = 0;
+        if (size <= 16)
+        {
+            if (size >= 4)
+            {
+                const auto offset = (size >> 3) << 2;
+                a = (read_u32(p) << 32) | read_u32(p + offset);
+                b = (read_u32(p + size - 4) << 32) | read_u32(p + size - 4 - offset);
+            }
+            else if (size > 0)
+            {
+                a = (read_u8(p) << 16) | (read_u8(p + (size >> 1)) << 8) | read_u8(p + size - 1);
+            }
+        }
+        else
+        {
+            size_t i = size;
+            if (i >= 48)
+            {
+                uint64_t seed1 = seed;
+                uint64_t seed2 = seed;
+                do
+                {
+                    seed = hash_mix(read_u64(p) ^ secret[1], read_u64(p + 8) ^ seed);
+                    seed1 = hash_mix(read_u64(p + 16) ^ secret[2], read_u64(p + 24) ^ seed1);
+                    seed2 = hash_mix(read_u64(p + 32) ^ secret[3], read_u64(p + 40) ^ seed2);
+                    p += 48;
+                    i -= 48;
+                } while (i >= 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while (i > 16)
+            {
+                seed = hash_mix(read_u64(p) ^ secret[1], read_u64(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read_u64(p + i - 16);
+            b = read_u64(p + i - 8);
+        }
+
+        a ^= secret[1];
+        b ^= seed;
+        multiply_128(a, b);
+        return static_cast<size_t>(hash_mix(a ^ secret[0] ^ size, b ^ secret[1]));
     }
-    return hash;
-}
+};
+
+namespace detail
+{
+
+class fixed_page;
+
+// pages are allocated together with their buffer from a memory_resource
+struct page_deleter
+{
+    std::pmr::memory_resource* resource;
+
+    void operator()(fixed_page* page) const;
+};
+
+using page_ptr = std::unique_ptr<fixed_page, page_deleter>;
 
 class fixed_page
 {
 
 public:
 
-    fixed_page(std::unique_ptr<fixed_page> previousPage) :previousPage_{ std::move(previousPage) }, remaining_{ page_size } {}
+    static page_ptr create(size_t capacity, std::pmr::memory_resource* resource);
 
-    bool        can_hold(size_t size);
-    const char* push_back(string_key key);
+    bool        can_hold(size_t size) const;
+    const char* push_back(std::string_view string);
+    // the strings are gone, the page can be filled again
+    void        clear() { remaining_ = capacity_; }
+
+    size_t capacity() const { return capacity_; }
 
 private:
 
-    std::unique_ptr<fixed_page> previousPage_; // depending on how many pages we make this will make a deep recursion when deleting?
-    /* ~fixed_page() {
-        while(previousPage_) { previousPage_ = std::move(previousPage_->previousPage_); }
-    } */
-    std::array<char, page_size> buffer_;
-    size_t                      remaining_;
+    friend page_deleter;
+
+    explicit fixed_page(size_t capacity) :capacity_{ capacity }, remaining_{ capacity } {}
+
+    char* buffer() { return reinterpret_cast<char*>(this + 1); }
+
+    size_t capacity_;
+    size_t remaining_;
+};
+
+// Copies strings into pages. Every new page is 16 times bigger than the last
+// until max_page_size. A string that is big compared to the pages gets a page
+// of its own, so the current page can still be filled. The pages are owned by
+// vectors, not linked to each other, so any number of them are freed in a
+// loop. clear keeps the pages for the next strings and frees the big ones.
+class page_allocator
+{
+
+public:
+
+    explicit page_allocator(
+        size_t first_page_size = page_size,
+        size_t max_page_size = losgodis::max_page_size,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // copies the string and adds a null terminator
+    const char* push_back(std::string_view string);
+    // takes over the pages of other, the strings in them stay where they are
+    void        splice(page_allocator& other);
+    // frees the strings, not the pages
+    void        clear();
+
+    size_t bytes_used() const { return page_bytes_used_; }
+    void   add_stats(pool_stats& stats) const;
+
+private:
+
+    static constexpr size_t growth_factor = 16;
+
+    std::pmr::memory_resource* resource_;
+    std::pmr::vector<page_ptr> pages_;           // filled in order, current_ is the one being filled
+    std::pmr::vector<page_ptr> dedicated_pages_; // big strings and pages of spliced allocators, never filled
+    size_t                     current_ = 0;
+    size_t                     next_page_size_;
+    size_t                     max_page_size_;
+    size_t                     page_count_ = 0;
+    size_t                     page_bytes_ = 0;
+    size_t                     page_bytes_used_ = 0;
+};
+
+// Open addressing hash set of the pooled strings, the strings themselves are
+// stored elsewhere. The slots are in groups of 8 with a control byte per slot,
+// either empty or the low 7 bits of the hash. A lookup matches the control
+// bytes of a whole group at once and compares the full hash before it touches
+// any string bytes.
+class string_index
+{
+
+public:
+
+    struct entry
+    {
+        const char* data;
+        size_t      size;
+        size_t      hash;
+    };
+
+    // hash is the hash of the pool, short strings are rehashed with it
+    string_index(hash_function hash, std::pmr::memory_resource* resource) :hash_{ hash }, resource_{ resource } {}
+    string_index(const string_index&) = delete;
+    string_index& operator=(const string_index&) = delete;
+    ~string_index();
+
+    // the pooled string data, nullptr if it is not in the index
+    const char* find(std::string_view view, size_t hash) const;
+    void        prefetch(size_t hash) const;
+    // the string can not already be in the index
+    void        insert(const entry& e);
+    void        reserve(size_t count);
+    // removes all strings but keeps the capacity
+    void        clear();
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return group_count_ * group_size; }
+
+    void add_stats(pool_stats& stats) const;
+    void append_entries(std::vector<entry>& entries) const;
+
+    static constexpr size_t group_size = 8;
+
+private:
+
+#if defined(LOSGODIS_STRING_POOL_STATS)
+    struct lookup_counters
+    {
+        size_t lookups = 0;
+        size_t hits = 0;
+        size_t probed_groups = 0;
+        size_t max_probed_groups = 0;
+    };
+
+    void count_lookup(bool hit, size_t probed_groups) const
+    {
+        counters_.lookups++;
+        counters_.hits += hit;
+        counters_.probed_groups += probed_groups;
+        counters_.max_probed_groups = probed_groups > counters_.max_probed_groups ? probed_groups : counters_.max_probed_groups;
+    }
+
+    mutable lookup_counters counters_;
+#else
+    void count_lookup(bool, size_t) const {}
+#endif
+
+    // Strings of up to max_inline_size bytes are kept in the slot words, zero
+    // padded and with the size in the last byte, so a lookup decides if they
+    // match without reading the string. Their hash is not kept, they are
+    // rehashed when the index grows. Longer strings keep the hash and the size
+    // with the top byte set, and are compared to the page.
+    struct slot
+    {
+        uint64_t    words[2];
+        const char* data;
+    };
+
+    struct group
+    {
+        uint64_t control;
+        slot     slots[group_size];
+    };
+
+    static constexpr size_t max_inline_size = 15;
+
+    static slot make_slot(const entry& e);
+    entry       make_entry(const slot& s) const;
+
+    // Bigger indexes grow in small steps done by the inserts. At load 3/4 the
+    // next groups are allocated and then cleared a few at a time, which is
+    // when their memory is first touched. When the index is full they replace
+    // the groups, the old groups are kept and each insert moves a few of them
+    // to the new ones. Lookups that miss the new groups also probe the old
+    // ones, they are not changed while moving.
+    static constexpr size_t incremental_group_count = size_t{ 1 } << 10;
+    static constexpr size_t groups_per_insert = 2;
+
+    group* allocate_groups(size_t count);
+    void   deallocate_groups(group* groups, size_t count);
+    void   rehash(size_t group_count, bool incremental);
+    void   clear_groups(size_t count);
+    void   move_groups(size_t count);
+    void   insert_slot(const slot& s, size_t hash);
+
+    hash_function              hash_;
+    std::pmr::memory_resource* resource_;
+    group*                     groups_ = nullptr;
+    size_t                     group_count_ = 0; // always a power of two
+    size_t                     size_ = 0;        // also the strings not moved yet
+    size_t                     growth_left_ = 0;
+    group*                     next_groups_ = nullptr;
+    size_t                     next_group_count_ = 0;
+    size_t                     cleared_groups_ = 0;
+    group*                     old_groups_ = nullptr;
+    size_t                     old_group_count_ = 0;
+    size_t                     moved_groups_ = 0;
+};
+
+// The index of a snapshot, laid out like string_index but with offsets into
+// the snapshot instead of pointers. Used in place, it is never modified.
+class snapshot_index
+{
+
+public:
+
+    struct slot
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t hash;
+    };
+
+    struct group
+    {
+        uint64_t control;
+        slot     slots[string_index::group_size];
+    };
+
+    snapshot_index() = default;
+    // throws std::invalid_argument if it is not a snapshot of the same hash policy
+    snapshot_index(string_pool_snapshot snapshot, uint64_t hash_check);
+
+    const char* find(std::string_view view, size_t hash) const { return group_count_ != 0 ? find_string(view, hash) : nullptr; }
+    void        prefetch(size_t hash) const;
+
+    void add_stats(pool_stats& stats) const;
+    void append_entries(std::vector<string_index::entry>& entries) const;
+
+    static void write(std::ostream& out, const std::vector<string_index::entry>& entries, uint64_t hash_check);
+    // the same snapshot in memory allocated from resource
+    static string_pool_snapshot write(const std::vector<string_index::entry>& entries, uint64_t hash_check, std::pmr::memory_resource* resource);
+
+private:
+
+    const char* find_string(std::string_view view, size_t hash) const;
+
+    const char*  data_ = nullptr;
+    const group* groups_ = nullptr;
+    size_t       group_count_ = 0;
+    size_t       size_ = 0;
+    size_t       string_bytes_ = 0;
 };
 
 } // namespace detail
@@ -96,15 +563,15 @@ class fixed_string
 
 public:
 
-    fixed_string(const fixed_string&) noexcept = default;
-    fixed_string& operator=(const fixed_string& other) noexcept = default;
+    constexpr fixed_string(const fixed_string&) noexcept = default;
+    constexpr fixed_string& operator=(const fixed_string& other) noexcept = default;
 
-    const char* data() const { return data_; }
-    size_t           size() const { return size_; }
+    constexpr const char* data() const { return data_; }
+    constexpr size_t           size() const { return size_; }
 
-    const char* c_str() const { return data_; }
-    std::string      str() const { return std::string{ data_, size_ }; }
-    std::string_view view() const { return std::string_view{ data_, size_ }; }
+    constexpr const char*      c_str() const { return data_; }
+    std::string                str() const { return std::string{ data_, size_ }; }
+    constexpr std::string_view view() const { return std::string_view{ data_, size_ }; }
 
     explicit operator const char* () const { return c_str(); }
     explicit operator std::string() const { return str(); }
@@ -112,33 +579,49 @@ public:
 
 private:
 
-    friend string_pool;
+    friend detail::string_pool_base;
+    friend detail::frozen_string_pool_base;
+    friend detail::concurrent_string_pool_base;
+    friend detail::thread_cache_base;
+    template <size_t N, class Hash> friend class basic_static_string_table;
 
-    // only allow string_pool to create them
-    fixed_string(const char* s, size_t size) noexcept :data_{ s }, size_{ size } {}
+    // only allow the pools to create them
+    constexpr fixed_string(const char* s, size_t size) noexcept :data_{ s }, size_{ size } {}
 
     const char* data_;
     size_t      size_;
 };
 
-inline bool operator==(fixed_string a, fixed_string b)
+// Result of get_validated_string, string is only set on success, error_offset
+// is the first problematic byte on error
+struct validated_string
+{
+    std::optional<fixed_string> string;
+    utf8::validation_error      error;
+    size_t                      error_offset;
+};
+
+constexpr bool operator==(fixed_string a, fixed_string b)
 {
     return a.data() == b.data();
 }
 
-inline bool operator!=(fixed_string a, fixed_string b)
+constexpr bool operator!=(fixed_string a, fixed_string b)
 {
     return a.data() != b.data();
 }
 
-class string_key
+template <class Hash>
+class basic_string_key
 {
 
 public:
 
-    constexpr explicit string_key(std::string_view string) noexcept :
+    using hash_policy = Hash;
+
+    constexpr explicit basic_string_key(std::string_view string) noexcept :
         view_{ string },
-        hash_{ detail::hash(string.data(), string.size()) }
+        hash_{ Hash::hash(string.data(), string.size()) }
     {
     }
 
@@ -147,34 +630,104 @@ public:
 
 private:
 
-    friend string_pool;
-    friend constexpr string_literal operator"" _key(const char*, std::size_t);
+    friend basic_hashed_string<Hash>;
 
-    constexpr string_key(std::string_view view, size_t hash) noexcept :view_{ view }, hash_{ hash } {}
+    constexpr basic_string_key(std::string_view view, size_t hash) noexcept :view_{ view }, hash_{ hash } {}
 
     std::string_view view_;
     size_t           hash_;
 };
 
 // needed for internal purposes
-constexpr bool operator==(string_key a, string_key b)
+template <class Hash>
+constexpr bool operator==(basic_string_key<Hash> a, basic_string_key<Hash> b)
 {
     return a.view() == b.view();
 }
 
+template <class Hash>
+class basic_hashed_string
+{
+
+public:
+
+    basic_hashed_string(const basic_hashed_string&) noexcept = default;
+    basic_hashed_string& operator=(const basic_hashed_string& other) noexcept = default;
+
+    const char* data() const { return string_.data(); }
+    size_t           size() const { return string_.size(); }
+    size_t           hash() const { return hash_; }
+
+    const char*            c_str() const { return string_.c_str(); }
+    std::string            str() const { return string_.str(); }
+    std::string_view       view() const { return string_.view(); }
+    basic_string_key<Hash> key() const { return basic_string_key<Hash>{ string_.view(), hash_ }; }
+
+    operator fixed_string() const { return string_; }
+
+    explicit operator const char* () const { return c_str(); }
+    explicit operator std::string() const { return str(); }
+    explicit operator std::string_view() const { return view(); }
+
+private:
+
+    friend basic_string_pool<Hash>;
+
+    basic_hashed_string(fixed_string string, size_t hash) noexcept :string_{ string }, hash_{ hash } {}
+
+    fixed_string string_;
+    size_t       hash_;
+};
+
+template <class Hash>
+bool operator==(basic_hashed_string<Hash> a, basic_hashed_string<Hash> b)
+{
+    return a.data() == b.data();
+}
+
+template <class Hash>
+bool operator!=(basic_hashed_string<Hash> a, basic_hashed_string<Hash> b)
+{
+    return a.data() != b.data();
+}
+
+// Transparent hash and equal for containers of hashed_string, for lookup with
+// string_key without making a hashed_string first.
+struct string_hash
+{
+    using is_transparent = void;
+
+    template <class Hash>
+    size_t operator()(const basic_hashed_string<Hash>& str) const { return str.hash(); }
+    template <class Hash>
+    size_t operator()(const basic_string_key<Hash>& key) const { return key.hash(); }
+};
+
+struct string_equal
+{
+    using is_transparent = void;
+
+    template <class Hash>
+    bool operator()(const basic_hashed_string<Hash>& a, const basic_hashed_string<Hash>& b) const { return a == b; }
+    template <class Hash>
+    bool operator()(const basic_hashed_string<Hash>& a, const basic_string_key<Hash>& b) const { return a.view() == b.view(); }
+    template <class Hash>
+    bool operator()(const basic_string_key<Hash>& a, const basic_hashed_string<Hash>& b) const { return a.view() == b.view(); }
+};
+
 } // namespace losgodis
 
 namespace std
 {
 
 // needed for internal purposes
-template <>
-class hash<losgodis::string_key>
+template <class Hash>
+class hash<losgodis::basic_string_key<Hash>>
 {
 
 public:
 
-    size_t operator()(const losgodis::string_key& key) const { return key.hash(); }
+    size_t operator()(const losgodis::basic_string_key<Hash>& key) const { return key.hash(); }
 };
 
 template <>
@@ -183,104 +736,408 @@ class hash<losgodis::fixed_string>
 
 public:
 
-    // maybe store hash to avoid hashing the pointer
+    // use hashed_string to avoid hashing the pointer
     size_t operator()(const losgodis::fixed_string& str) const { return std::hash<const char*>{}(str.data()); }
 };
 
+template <class Hash>
+class hash<losgodis::basic_hashed_string<Hash>>
+{
+
+public:
+
+    size_t operator()(const losgodis::basic_hashed_string<Hash>& str) const { return str.hash(); }
+};
+
 } // namespace std
 
 namespace losgodis
 {
 
-class string_literal
+template <class Hash>
+class basic_string_literal
 {
 
 public:
 
-    const string_key key_;
+    const basic_string_key<Hash> key_;
+
+    // the same literal hashed with another policy
+    template <class OtherHash>
+    constexpr explicit basic_string_literal(basic_string_literal<OtherHash> other) :key_{ other.key_.view() } {}
 
     // used to insert into string_pool map
-    operator string_key() const { return key_; }
+    constexpr operator basic_string_key<Hash>() const { return key_; }
 
 private:
 
-    friend constexpr string_literal operator"" _key(const char*, std::size_t);
+    friend detail::literal_access;
 
-    constexpr explicit string_literal(string_key key) :key_{ key } {}
+    constexpr explicit basic_string_literal(basic_string_key<Hash> key) :key_{ key } {}
+};
+
+// only string literals should be made string_literal
+struct detail::literal_access
+{
+    template <class Hash>
+    static constexpr basic_string_literal<Hash> make(const char* str, std::size_t size)
+    {
+        return basic_string_literal<Hash>{ basic_string_key<Hash>{ std::string_view{ str, size } } };
+    }
 };
 
 constexpr string_literal operator"" _key(const char* str, std::size_t size)
 {
-    return string_literal{ string_key { std::string_view{ str, size }, detail::hash(str, size) } };
+    return detail::literal_access::make<default_hash>(str, size);
 }
 
-class string_pool
+namespace detail
+{
+
+// The part of string_pool that does not depend on the hash policy, works on
+// the string and its precomputed hash.
+class string_pool_base
 {
 
 public:
 
-    string_pool() = default;
-    // put a bunch of literals in pool without copying string data
-    string_pool(std::initializer_list<string_literal> list);
+    string_pool_base(const string_pool_base&) = delete;
+    string_pool_base& operator=(const string_pool_base&) = delete;
 
-    fixed_string get_string(string_key string);
-    fixed_string get_string(string_literal string); // special one that does not copy
-    fixed_string get_string(std::string_view string) { return get_string(string_key{ string }); }
-    // maybe dont have this one? you have to make a string_view?
-    // fixed_string getString(const char* string) { return getString(string_key{ string }); }
-    fixed_string get_string(const std::string& string) { return get_string(string_key{ string }); }
+protected:
+
+    string_pool_base(hash_function hash, size_t first_page_size, size_t max_page_size, std::pmr::memory_resource* resource) :
+        index_{ hash, resource },
+        pages_{ first_page_size, max_page_size, resource },
+        resource_{ resource }
+    {
+    }
+    string_pool_base(string_pool_snapshot snapshot, hash_function hash, uint64_t hash_check, std::pmr::memory_resource* resource) :
+        snapshot_{ snapshot, hash_check },
+        index_{ hash, resource },
+        pages_{ page_size, max_page_size, resource },
+        resource_{ resource }
+    {
+    }
+
+    std::pmr::memory_resource* resource() const { return resource_; }
+    uint64_t                   clear_count() const { return clear_count_; }
+
+    pool_stats stats() const;
+    void       write_snapshot(std::ostream& out, uint64_t hash_check) const;
+    // the strings of the snapshot and of the index
+    void       append_entries(std::vector<string_index::entry>& entries) const;
+    // both pools have to have the same hash policy
+    void       merge(string_pool_base& other);
+    void       clear();
+
+    fixed_string get_string(std::string_view string, size_t hash);
+    fixed_string get_literal(std::string_view string, size_t hash); // special one that does not copy
+    // copies a string that is not in the pool yet, without looking it up
+    fixed_string add_string(std::string_view string, size_t hash);
+    template <class Key>
+    void         get_strings(const Key* keys, size_t count, std::vector<fixed_string>& out);
+
+    std::optional<fixed_string> find(std::string_view string, size_t hash) const;
+    template <class Key>
+    void                        find_many(const Key* keys, size_t count, std::vector<std::optional<fixed_string>>& out) const;
+
+    void reserve(size_t count) { index_.reserve(count); }
 
 private:
 
-    /*
-    struct entry
+    // far enough ahead for the prefetch to be done before the key is reached
+    static constexpr size_t prefetch_distance = 8;
+
+    void prefetch(size_t hash) const
     {
-        std::string_view view;
-        hash_t           hash;
-    };
-    */
+        snapshot_.prefetch(hash);
+        index_.prefetch(hash);
+    }
+
+    detail::snapshot_index     snapshot_;
+    detail::string_index       index_;
+    detail::page_allocator     pages_;
+    std::pmr::memory_resource* resource_;
+    size_t                     string_bytes_ = 0;
+    uint64_t                   clear_count_ = 0;
+};
+
+// Looks up all keys before adding the ones that are missing, prefetching the
+// index for the keys ahead.
+template <class Key>
+void string_pool_base::get_strings(const Key* keys, size_t count, std::vector<fixed_string>& out)
+{
+    // no index_.reserve, that would rehash the whole index at once, the misses
+    // are added one by one and a big index grows a bit at a time
+    out.reserve(out.size() + count);
+    const auto first = out.size();
+
+    // misses are left as null strings
+    std::vector<size_t> misses;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i + prefetch_distance < count)
+        {
+            prefetch(keys[i + prefetch_distance].hash());
+        }
+
+        const auto& key = keys[i];
+        LOSGODIS_TRACE_GET_STRING_BEGIN(key.view());
+        auto str = snapshot_.find(key.view(), key.hash());
+        if (str == nullptr)
+        {
+            str = index_.find(key.view(), key.hash());
+        }
+        if (str == nullptr)
+        {
+            misses.push_back(i);
+        }
+        else
+        {
+            LOSGODIS_TRACE_GET_STRING_HIT(key.view());
+        }
+        out.push_back(fixed_string{ str, key.view().size() });
+    }
+
+    // The misses are not in the pool so they are added without looking them
+    // up again, only a key that is in the batch more than once has to be
+    // found. Sorted by hash such keys are next to each other, the first one
+    // is added and the others get its string.
+    std::sort(misses.begin(), misses.end(), [keys](size_t a, size_t b)
+    {
+        return keys[a].hash() != keys[b].hash() ? keys[a].hash() < keys[b].hash() : a < b;
+    });
+    for (size_t m = 0; m < misses.size(); ++m)
+    {
+        const auto& key = keys[misses[m]];
+        auto& str = out[first + misses[m]];
+        for (auto k = m; k-- > 0 && keys[misses[k]].hash() == key.hash();)
+        {
+            if (out[first + misses[k]].view() == key.view())
+            {
+                str = out[first + misses[k]];
+                LOSGODIS_TRACE_GET_STRING_HIT(key.view());
+                break;
+            }
+        }
+        if (str.data() == nullptr)
+        {
+            str = add_string(key.view(), key.hash());
+        }
+    }
+}
+
+// find for every key, prefetching like get_strings
+template <class Key>
+void string_pool_base::find_many(const Key* keys, size_t count, std::vector<std::optional<fixed_string>>& out) const
+{
+    out.reserve(out.size() + count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i + prefetch_distance < count)
+        {
+            prefetch(keys[i + prefetch_distance].hash());
+        }
+        out.push_back(find(keys[i].view(), keys[i].hash()));
+    }
+}
+
+// The part of frozen_string_pool that does not depend on the hash policy, the
+// snapshot it reads from is owned by it.
+class frozen_string_pool_base
+{
 
-    using entry = string_key; // entry need to enforce null termination! but string_key does not
-    std::unordered_set<entry> map_;
-    //std::unordered_map<string_key, fixed_string> map_;
+public:
+
+    frozen_string_pool_base(const frozen_string_pool_base&) = delete;
+    frozen_string_pool_base& operator=(const frozen_string_pool_base&) = delete;
+
+protected:
+
+    frozen_string_pool_base(const std::vector<string_index::entry>& entries, uint64_t hash_check, std::pmr::memory_resource* resource);
+    frozen_string_pool_base(frozen_string_pool_base&& other) noexcept;
+    ~frozen_string_pool_base();
+
+    std::pmr::memory_resource* resource() const { return resource_; }
+    string_pool_snapshot       snapshot() const { return memory_; }
 
-    std::unique_ptr<detail::fixed_page> page_;
+    std::optional<fixed_string> find(std::string_view string, size_t hash) const;
+    pool_stats                  stats() const;
+    void                        write_snapshot(std::ostream& out) const;
+
+private:
+
+    std::pmr::memory_resource* resource_;
+    string_pool_snapshot       memory_;
+    snapshot_index             index_;
 };
 
-#if 0
+// stored in a snapshot so it is not used with another hash policy
+template <class Hash>
+constexpr uint64_t snapshot_hash_check() { return Hash::hash("losgodis", 8); }
 
-struct pooled_string
+} // namespace detail
+
+template <class Hash>
+class basic_frozen_string_pool : private detail::frozen_string_pool_base
 {
-    // if we want relocateble block we want to use index instead of ptrs
-    // but then you need to know of the pool to get the actual string
 
-    //const int index;
-    //const int counter;
-    const size_t id_;
-    void* const pool_;
+public:
+
+    using key_type = basic_string_key<Hash>;
+    using literal_type = basic_string_literal<Hash>;
+
+    basic_frozen_string_pool(basic_frozen_string_pool&& other) noexcept = default;
+
+    std::optional<fixed_string> find(key_type string) const { return frozen_string_pool_base::find(string.view(), string.hash()); }
+    std::optional<fixed_string> find(literal_type string) const { return find(string.key_); }
+    std::optional<fixed_string> find(std::string_view string) const { return find(key_type{ string }); }
+    std::optional<fixed_string> find(const std::string& string) const { return find(key_type{ string }); }
 
-    size_t index() const; // mask id
-    size_t counter() const; // mask id
+    bool contains(key_type string) const { return find(string).has_value(); }
+
+    // the same snapshot that write_snapshot writes, a string_pool made from it
+    // uses the strings in place but the frozen pool has to outlive it
+    using frozen_string_pool_base::snapshot;
+    void write_snapshot(std::ostream& out) const { frozen_string_pool_base::write_snapshot(out); }
+
+    using frozen_string_pool_base::resource;
+    using frozen_string_pool_base::stats;
+
+private:
 
-    size_t size() const;
-    const char* c_str() const;
+    friend class basic_string_pool<Hash>;
+
+    basic_frozen_string_pool(const std::vector<detail::string_index::entry>& entries, std::pmr::memory_resource* resource) :
+        frozen_string_pool_base{ entries, detail::snapshot_hash_check<Hash>(), resource }
+    {
+    }
 };
 
-struct dynamic_pool
+template <class Hash>
+class basic_string_pool : private detail::string_pool_base
 {
-    struct entry
+
+public:
+
+    using key_type = basic_string_key<Hash>;
+    using literal_type = basic_string_literal<Hash>;
+    using hashed_string_type = basic_hashed_string<Hash>;
+
+    basic_string_pool() :basic_string_pool{ std::pmr::get_default_resource() } {}
+    // pages and index are allocated from resource, it has to outlive the pool
+    explicit basic_string_pool(std::pmr::memory_resource* resource) :
+        string_pool_base{ &Hash::hash, page_size, max_page_size, resource }
     {
-        size_t                  counter_;
-        size_t                  size_;
-        std::unique_ptr<char[]> str_;
-    };
-    std::vector<entry> pool_;
-    size_t             firstFree_;
+    }
+    // the size of the first page, the pages then grow up to max_page_size
+    explicit basic_string_pool(
+        size_t first_page_size,
+        size_t max_page_size = losgodis::max_page_size,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        string_pool_base{ &Hash::hash, first_page_size, max_page_size, resource }
+    {
+    }
+    // uses the snapshot memory in place, throws std::invalid_argument if it is
+    // not a snapshot written by a pool with the same hash policy
+    explicit basic_string_pool(string_pool_snapshot snapshot, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        string_pool_base{ snapshot, &Hash::hash, hash_check(), resource }
+    {
+    }
+    // put a bunch of literals in pool without copying string data
+    basic_string_pool(std::initializer_list<literal_type> list, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        string_pool_base{ &Hash::hash, page_size, max_page_size, resource }
+    {
+        reserve(list.size());
+        for (const auto& literal : list)
+        {
+            get_string(literal);
+        }
+    }
 
-    pooled_string get_string(string_key str);
-    void remove_string(string_key str);
-};
+    fixed_string get_string(key_type string) { return string_pool_base::get_string(string.view(), string.hash()); }
+    fixed_string get_string(literal_type string) { return get_literal(string.key_.view(), string.key_.hash()); } // special one that does not copy
+    fixed_string get_string(std::string_view string) { return get_string(key_type{ string }); }
+    // maybe dont have this one? you have to make a string_view?
+    // fixed_string getString(const char* string) { return getString(string_key{ string }); }
+    fixed_string get_string(const std::string& string) { return get_string(key_type{ string }); }
 
-#endif
+    // same as get_string but keeps the hash
+    hashed_string_type get_hashed_string(key_type string) { return hashed_string_type{ get_string(string), string.hash() }; }
+    hashed_string_type get_hashed_string(literal_type string) { return hashed_string_type{ get_string(string), string.key_.hash() }; }
+
+    // get_string for a string that has to be valid utf8. Short ascii strings,
+    // most identifiers, are checked inline so the bytes are read from memory
+    // once, by the check, and then hashed from the cache.
+    validated_string get_validated_string(std::string_view string)
+    {
+        constexpr size_t inline_check_size = 64;
+
+        const utf8::byte_range range{ string.data(), string.size() };
+        if (string.size() > inline_check_size || !utf8::is_ascii(range))
+        {
+            const auto result = utf8::validate(range);
+            if (result.error != utf8::validation_error::success)
+            {
+                return { std::nullopt, result.error, result.range.size() };
+            }
+        }
+        return { get_string(string), utf8::validation_error::success, 0 };
+    }
+
+    // get_string for count keys, the strings are appended to out in the same
+    // order. The index is prefetched a few keys ahead of the lookups.
+    void get_strings(const key_type* keys, size_t count, std::vector<fixed_string>& out) { string_pool_base::get_strings(keys, count, out); }
+
+    // the pooled string if there is one, never adds it and does not allocate
+    std::optional<fixed_string> find(key_type string) const { return string_pool_base::find(string.view(), string.hash()); }
+    std::optional<fixed_string> find(literal_type string) const { return find(string.key_); }
+    std::optional<fixed_string> find(std::string_view string) const { return find(key_type{ string }); }
+    std::optional<fixed_string> find(const std::string& string) const { return find(key_type{ string }); }
+
+    bool contains(key_type string) const { return find(string).has_value(); }
+
+    // find for count keys, appended to out in the same order
+    void find_many(const key_type* keys, size_t count, std::vector<std::optional<fixed_string>>& out) const { string_pool_base::find_many(keys, count, out); }
+
+    // makes room in the index for count strings, so it does not have to grow
+    // until there are more
+    using string_pool_base::reserve;
+
+    // all strings of the pool, also the ones from its snapshot
+    void write_snapshot(std::ostream& out) const { string_pool_base::write_snapshot(out, hash_check()); }
+
+    // an immutable copy of all strings, allocated from resource
+    basic_frozen_string_pool<Hash> freeze() const { return freeze(resource()); }
+    basic_frozen_string_pool<Hash> freeze(std::pmr::memory_resource* resource) const
+    {
+        std::vector<detail::string_index::entry> entries;
+        append_entries(entries);
+        return basic_frozen_string_pool<Hash>{ entries, resource };
+    }
+
+    // moves the strings of other into the pool, other is left empty
+    void merge(basic_string_pool&& other) { string_pool_base::merge(other); }
+
+    // removes all strings but the ones of the snapshot, the pages and the
+    // index are kept for the strings added after. fixed_strings from before
+    // are invalid.
+    using string_pool_base::clear;
+    // how often the pool was cleared or merged into another one, a cache of
+    // its fixed_strings is stale when it changes
+    using string_pool_base::clear_count;
+
+    using string_pool_base::resource;
+    using string_pool_base::stats;
+
+private:
+
+    static constexpr uint64_t hash_check() { return detail::snapshot_hash_check<Hash>(); }
+};
 
 } // namespace losgodis
+
+#if defined(LOSGODIS_HEADER_ONLY)
+#include "../../src/losgodis/string_pool.cpp"
+#endif
@@ -0,0 +1,166 @@
+#pragma once
+
+/*
+
+    symbol
+
+A pooled string as a dense 32 bit index into its symbol_pool, a quarter of 
+the size of a fixed_string. Comparing and hashing a symbol only looks at the 
+index, the string itself is only available through the pool that made it. A 
+default constructed symbol is not in any pool.
+
+
+    symbol_pool
+
+Interns strings as symbols. The string data of all symbols is stored back to 
+back in one buffer, with an array of offsets indexed by the symbol, like a 
+string column. The views returned by view and c_str are only valid until the 
+next string is added, the buffer may move when it grows.
+
+*/
+
+#include "losgodis/string_pool.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+namespace losgodis
+{
+
+class symbol
+{
+
+public:
+
+    static constexpr uint32_t invalid_id = std::numeric_limits<uint32_t>::max();
+
+    constexpr symbol() noexcept = default;
+    constexpr explicit symbol(uint32_t id) noexcept :id_{ id } {}
+
+    constexpr uint32_t id() const { return id_; }
+    constexpr bool     valid() const { return id_ != invalid_id; }
+
+private:
+
+    uint32_t id_ = invalid_id;
+};
+
+constexpr bool operator==(symbol a, symbol b) { return a.id() == b.id(); }
+constexpr bool operator!=(symbol a, symbol b) { return a.id() != b.id(); }
+// in the order the symbols were added
+constexpr bool operator<(symbol a, symbol b) { return a.id() < b.id(); }
+
+namespace detail
+{
+
+// The part of symbol_pool that does not depend on the hash policy.
+class symbol_pool_base
+{
+
+public:
+
+    symbol_pool_base(const symbol_pool_base&) = delete;
+    symbol_pool_base& operator=(const symbol_pool_base&) = delete;
+
+    // s has to be a valid symbol of this pool
+    std::string_view view(symbol s) const
+    {
+        assert(s.valid() && s.id() < size());
+        const auto begin = offsets_[s.id()];
+        return std::string_view{ chars_.data() + begin, static_cast<size_t>(offsets_[s.id() + 1] - begin - 1) };
+    }
+    const char* c_str(symbol s) const
+    {
+        assert(s.valid() && s.id() < size());
+        return chars_.data() + offsets_[s.id()];
+    }
+    std::string str(symbol s) const { return std::string{ view(s) }; }
+
+    // the number of symbols, they have the ids 0 to size - 1
+    size_t size() const { return offsets_.size() - 1; }
+
+protected:
+
+    explicit symbol_pool_base(std::pmr::memory_resource* resource);
+    ~symbol_pool_base();
+
+    symbol get_symbol(std::string_view string, size_t hash);
+    symbol find(std::string_view string, size_t hash) const;
+
+    void reserve(size_t count, size_t bytes);
+
+private:
+
+    struct group
+    {
+        uint64_t control;
+        uint32_t slots[string_index::group_size];
+    };
+
+    void rehash(size_t group_count);
+
+    std::pmr::memory_resource* resource_;
+    std::pmr::vector<char>     chars_;
+    std::pmr::vector<uint64_t> offsets_; // size() + 1, the last one is the end of chars_
+    std::pmr::vector<size_t>   hashes_;
+    group*                     groups_ = nullptr;
+    size_t                     group_count_ = 0;
+    size_t                     growth_left_ = 0;
+};
+
+} // namespace detail
+
+template <class Hash = default_hash>
+class basic_symbol_pool : private detail::symbol_pool_base
+{
+
+public:
+
+    using key_type = basic_string_key<Hash>;
+    using literal_type = basic_string_literal<Hash>;
+
+    basic_symbol_pool() :basic_symbol_pool{ std::pmr::get_default_resource() } {}
+    explicit basic_symbol_pool(std::pmr::memory_resource* resource) :symbol_pool_base{ resource } {}
+
+    symbol get_symbol(key_type string) { return symbol_pool_base::get_symbol(string.view(), string.hash()); }
+    symbol get_symbol(literal_type string) { return get_symbol(string.key_); }
+    symbol get_symbol(std::string_view string) { return get_symbol(key_type{ string }); }
+    symbol get_symbol(const std::string& string) { return get_symbol(key_type{ string }); }
+
+    // an invalid symbol if the string is not in the pool
+    symbol find(key_type string) const { return symbol_pool_base::find(string.view(), string.hash()); }
+    symbol find(literal_type string) const { return find(string.key_); }
+    symbol find(std::string_view string) const { return find(key_type{ string }); }
+    symbol find(const std::string& string) const { return find(key_type{ string }); }
+
+    // room for count symbols with bytes of string data in total
+    void reserve(size_t count, size_t bytes = 0) { symbol_pool_base::reserve(count, bytes); }
+
+    using symbol_pool_base::c_str;
+    using symbol_pool_base::size;
+    using symbol_pool_base::str;
+    using symbol_pool_base::view;
+};
+
+using symbol_pool = basic_symbol_pool<>;
+
+} // namespace losgodis
+
+namespace std
+{
+
+template <>
+class hash<losgodis::symbol>
+{
+
+public:
+
+    size_t operator()(losgodis::symbol s) const { return s.id(); }
+};
+
+} // namespace std
+
+#if defined(LOSGODIS_HEADER_ONLY)
+#include "../../src/losgodis/symbol_pool.cpp"
+#endif
@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+
+    thread_cache
+
+A small per thread cache in front of a pool that is shared between threads, 
+like concurrent_string_pool, for the few strings that every thread asks for 
+all the time. It has the same get_string overloads as the pool. The cache is 
+direct mapped on the hash of the key, a hit only reads memory of the calling 
+thread and the pooled string, no locks or atomics. A miss asks the pool and 
+replaces the entry.
+
+All thread_caches share the cache of a thread, cache_size entries of 40 
+bytes. Each thread_cache gets an id that is never reused and the entries are 
+tagged with it, so the entries of a thread_cache that is destroyed, together 
+with its pool, never match again. The entries are also tagged with the 
+clear_count of the pool, if it has one, so the strings of a string_pool that 
+is cleared are not returned after. The pool has to outlive the thread_cache. 
+A thread_cache can be shared between the threads, and it is only as thread 
+safe as its pool.
+
+*/
+
+#include "losgodis/string_pool.hpp"
+
+#include <cstdint>
+#include <optional>
+
+namespace losgodis
+{
+
+namespace detail
+{
+
+// The part of thread_cache that does not depend on the pool.
+class thread_cache_base
+{
+
+public:
+
+    // 10 KiB per thread, for the strings that are asked for all the time,
+    // not for all of them
+    static constexpr size_t cache_size = 256;
+
+    thread_cache_base(const thread_cache_base&) = delete;
+    thread_cache_base& operator=(const thread_cache_base&) = delete;
+
+protected:
+
+    thread_cache_base();
+
+    // in the cache of the calling thread, for the clear_count of the pool
+    std::optional<fixed_string> find(std::string_view string, size_t hash, uint64_t clear_count) const;
+    void                        store(fixed_string string, size_t hash, uint64_t clear_count) const;
+
+private:
+
+    const uint64_t id_;
+};
+
+// the clear_count of a pool that can be cleared, 0 for the others
+template <class Pool>
+auto pool_clear_count(const Pool& pool, int) -> decltype(pool.clear_count()) { return pool.clear_count(); }
+template <class Pool>
+uint64_t pool_clear_count(const Pool&, long) { return 0; }
+
+} // namespace detail
+
+template <class Pool>
+class thread_cache : private detail::thread_cache_base
+{
+
+public:
+
+    using pool_type = Pool;
+    using key_type = typename Pool::key_type;
+    using literal_type = typename Pool::literal_type;
+
+    explicit thread_cache(Pool& pool) :pool_{ pool } {}
+
+    fixed_string get_string(key_type string) { return get_cached(string, string); }
+    fixed_string get_string(literal_type string) { return get_cached(string.key_, string); }
+    fixed_string get_string(std::string_view string) { return get_string(key_type{ string }); }
+    fixed_string get_string(const std::string& string) { return get_string(key_type{ string }); }
+
+    Pool& pool() const { return pool_; }
+
+private:
+
+    // string is passed on to the pool as is so literals are not copied
+    template <class String>
+    fixed_string get_cached(const key_type& key, const String& string)
+    {
+        const uint64_t clear_count = detail::pool_clear_count(pool_, 0);
+        if (const auto cached = find(key.view(), key.hash(), clear_count))
+        {
+            return *cached;
+        }
+        const auto pooled = pool_.get_string(string);
+        store(pooled, key.hash(), clear_count);
+        return pooled;
+    }
+
+    Pool& pool_;
+};
+
+} // namespace losgodis
+
+#if defined(LOSGODIS_HEADER_ONLY)
+#include "../../src/losgodis/thread_cache.cpp"
+#endif
@@ -6,14 +6,27 @@
 
 Iterator for a utf8 range. Iterates over the unicode codepoints of the range.
 Exhibits undefined behaviour if the underlying data is not a valid utf8 string,
-specifically there is no guarantee that the iterator will reach the end.
+specifically there is no guarantee that the iterator will reach the end. It is
+bidirectional, operator-- steps back over the continuation bytes. next decodes
+and advances in one step, operator* remembers the length it decoded so a range
+for loop only decodes each codepoint once.
 
 
     utf8_range
 
 Represents a utf8 string. Can be constructed either by calling one of the 
 validate functions, or manually in which case it is up to the user to ensure
-that the underlying bytes represents a valid utf8 string.
+that the underlying bytes represents a valid utf8 string. A range from the
+validate functions knows its codepoint count, a manual one only if given.
+at and substr find codepoints by counting from the start, skipping 64 bytes at
+a time, use a codepoint_index to do it repeatedly on the same range.
+
+
+    codepoint_index
+
+Sparse index of a utf8 range, the byte offset of every stride:th codepoint.
+at and substr look up the closest offset before the codepoint and step less
+than stride codepoints from there. It costs a size_t per stride codepoints.
 
 
     byte_range
@@ -26,13 +39,51 @@ Represents a range of bytes, it is the input to the validate functions.
 Validates a range of bytes and returns validation_result, which indicates
 any potential errors, contains a utf8 range up to the first invalid byte, and 
 the number of codepoints in the utf8 range. validate_quick will not check for
-invalid unicode codepoints and overlong encodings.
+invalid unicode codepoints and overlong encodings. Both use simd kernels 
+(sse4.2, avx2, avx-512 or neon) picked at runtime when the cpu supports them, 
+define LOSGODIS_UTF8_NO_SIMD to only use the scalar validator. is_ascii is a 
+quick inline check a word at a time, for short strings that are most likely 
+ascii and so valid without calling a validate function.
+
+
+    count_codepoints
+
+The number of codepoints in a utf8 range, the count the range knows if it
+has one, otherwise the number of non continuation bytes counted with the simd
+kernels, or a word at a time without them.
+
+
+    stream_validator
+
+Validates a byte stream that arrives in chunks, like reads from a socket,
+without copying it into one buffer. Each chunk goes through the same simd
+validator, a codepoint split between two chunks is carried over in at most 
+3 bytes. Every call returns the running stream_result, the byte count and
+codepoint count of the complete codepoints so far, on error the byte count is
+the offset in the stream of the first problematic byte, the same position
+validate would give for the whole stream. finish reports a codepoint left
+unfinished at the end of the stream.
+
+
+    validate_parallel
+
+Validates a big range in chunks spread over an executor, a callable that runs
+the std::function<void()> it is given at some point on some thread, usually by
+posting it to a thread pool. The chunks are cut at codepoint boundaries and
+the result is the same as from validate, including the first error, chunks
+after a failed one are skipped. It blocks until all chunks are done.
 
 */
 
+#include "losgodis/config.hpp"
+
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <vector>
 
 namespace losgodis::utf8
 {
@@ -45,61 +96,93 @@ class iterator
 
 public:
 
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = codepoint_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = codepoint_t;
+
     iterator(const char* str) : str_{ str } {}
 
-    codepoint_t operator*() const
+    const char* data() const { return str_; }
+
+    // decodes the codepoint and moves past it, on invalid utf8 a continuation
+    // byte or a byte above 0xF7 is stepped over on its own
+    iterator& next(codepoint_t& codepoint)
     {
         const auto byte0 = byte(0);
         if (byte0 < 0x80u) // 0xxxxxxx
         {
-            return byte0;
+            codepoint = byte0;
+            str_ += 1;
         }
         else if (byte0 < 0xE0u) // 110xxxxx 10xxxxxx
         {
-            return ((byte0 & 0x1Fu) << 6) | (byte(1) & 0x3Fu);
+            assert(byte0 >= 0xC0u);
+            codepoint = ((byte0 & 0x1Fu) << 6) | (byte(1) & 0x3Fu);
+            str_ += byte0 >= 0xC0u ? 2 : 1;
         }
         else if (byte0 < 0xF0u) // 1110xxxx 10xxxxxx 10xxxxxx
         {
-            return ((byte0 & 0xFu) << 12) | ((byte(1) & 0x3Fu) << 6) | (byte(2) & 0x3Fu);
+            codepoint = ((byte0 & 0xFu) << 12) | ((byte(1) & 0x3Fu) << 6) | (byte(2) & 0x3Fu);
+            str_ += 3;
         }
-        else // if (b1 < 0xF8u) // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+        else // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
         {
-            return ((byte0 & 0x7u) << 18) | ((byte(1) & 0x3Fu) << 12) | ((byte(2) & 0x3Fu) << 6) | (byte(3) & 0x3Fu);
+            assert(byte0 < 0xF8u);
+            codepoint = ((byte0 & 0x7u) << 18) | ((byte(1) & 0x3Fu) << 12) | ((byte(2) & 0x3Fu) << 6) | (byte(3) & 0x3Fu);
+            str_ += byte0 < 0xF8u ? 4 : 1;
         }
+        length_ = 0;
+        return *this;
+    }
+
+    // remembers the length so the following operator++ does not decode again
+    codepoint_t operator*() const
+    {
+        iterator it{ str_ };
+        codepoint_t codepoint;
+        it.next(codepoint);
+        length_ = static_cast<uint8_t>(it.str_ - str_);
+        return codepoint;
     }
 
     iterator& operator++()
     {
-        const auto byte0 = byte(0);
-        if (byte0 <= 0x7Fu)
-        {
-            str_ += 1;
-        }
-        else if (byte0 <= 0xBFu)
+        if (length_ == 0)
         {
-            assert(false);
-            str_ += 1;
+            codepoint_t codepoint;
+            return next(codepoint);
         }
-        else if (byte0 <= 0xDFu)
-        {
-            str_ += 2;
-        }
-        else if (byte0 <= 0xEFu)
-        {
-            str_ += 3;
-        }
-        else if (byte0 <= 0xF7u)
-        {
-            str_ += 4;
-        }
-        else
+        str_ += length_;
+        length_ = 0;
+        return *this;
+    }
+
+    iterator& operator--()
+    {
+        do
         {
-            assert(false);
-            str_ += 1;
-        }
+            str_ -= 1;
+        } while ((byte(0) & 0xC0u) == 0x80u);
+        length_ = 0;
         return *this;
     }
 
+    iterator operator++(int)
+    {
+        auto it = *this;
+        ++*this;
+        return it;
+    }
+
+    iterator operator--(int)
+    {
+        auto it = *this;
+        --*this;
+        return it;
+    }
+
     bool operator==(const iterator& RHS) const { return str_ == RHS.str_; }
     bool operator!=(const iterator& RHS) const { return str_ != RHS.str_; }
 
@@ -107,7 +190,8 @@ private:
 
     uint8_t byte(size_t offset) const { return static_cast<uint8_t>(*(str_ + offset)); }
 
-    const char* str_;
+    const char*     str_;
+    mutable uint8_t length_ = 0; // of the codepoint at str_ if operator* has decoded it
 };
 
 class utf8_range
@@ -115,15 +199,35 @@ class utf8_range
 
 public:
 
-    utf8_range(const char* start, size_t byte_count) :start_{ start }, byte_count_{ byte_count }{}
+    static constexpr size_t unknown_count = SIZE_MAX;
+    static constexpr size_t npos = SIZE_MAX;
+
+    utf8_range(const char* start, size_t byte_count, size_t codepoint_count = unknown_count) :
+        start_{ start }, byte_count_{ byte_count }, codepoint_count_{ codepoint_count }{}
 
     iterator begin() const { return iterator{ start_ }; }
     iterator end() const { return iterator{ start_ + byte_count_ }; }
 
+    const char* data() const { return start_; }
+    size_t      size() const { return byte_count_; }
+
+    // unknown_count unless it came from validation or was given
+    size_t known_codepoint_count() const { return codepoint_count_; }
+
+    // count_codepoints, which is O(1) when the count is known
+    size_t codepoint_count() const;
+
+    // codepoint n, which has to be in the range
+    codepoint_t at(size_t n) const;
+
+    // count codepoints from pos, or up to the end, pos has to be in the range or at the end
+    utf8_range substr(size_t pos, size_t count = npos) const;
+
 private:
 
     const char* start_;
     size_t      byte_count_;
+    size_t      codepoint_count_;
 };
 
 class byte_range
@@ -138,7 +242,10 @@ public:
 
     uint8_t operator[](size_t index) const { return static_cast<uint8_t>(*(start_ + index)); }
 
-    utf8_range to_utf8(size_t size) const { return utf8_range{ start_, size }; }
+    utf8_range to_utf8(size_t size, size_t codepoint_count = utf8_range::unknown_count) const
+    {
+        return utf8_range{ start_, size, codepoint_count };
+    }
 
 private:
 
@@ -162,7 +269,7 @@ struct validation_result
 {
     validation_error error;
     utf8_range       range;
-    size_t           codepoint_count; // maybe put in range, but then allow it to be unknown, for user ranges
+    size_t           codepoint_count; // also known by range
 };
 
 validation_result validate(byte_range range);
@@ -170,4 +277,100 @@ validation_result validate(byte_range range);
 // do not check invalid_codepoint and overlong_enocoding
 validation_result validate_quick(byte_range range);
 
+inline bool is_ascii(byte_range range)
+{
+    constexpr uint64_t high_bits = 0x8080808080808080u;
+
+    const auto data = range.begin();
+    size_t i = 0;
+    for (; range.size() - i >= 8; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        if (word & high_bits) { return false; }
+    }
+    for (; i < range.size(); ++i)
+    {
+        if (range[i] >= 0x80u) { return false; }
+    }
+    return true;
+}
+
+size_t count_codepoints(utf8_range range);
+
+inline size_t utf8_range::codepoint_count() const { return count_codepoints(*this); }
+
+class codepoint_index
+{
+
+public:
+
+    static constexpr size_t stride = 64;
+
+    explicit codepoint_index(utf8_range range);
+
+    utf8_range range() const { return range_; }
+    size_t     size() const { return codepoint_count_; }
+
+    // the byte offset of codepoint n, range().size() for n == size()
+    size_t offset(size_t n) const;
+
+    codepoint_t at(size_t n) const;
+    utf8_range  substr(size_t pos, size_t count = utf8_range::npos) const;
+
+private:
+
+    utf8_range          range_;
+    size_t              codepoint_count_;
+    std::vector<size_t> offsets_; // of codepoint stride * i
+};
+
+using executor = std::function<void(std::function<void()>)>;
+
+inline constexpr size_t parallel_chunk_size = size_t{ 1 } << 20;
+
+validation_result validate_parallel(byte_range range, const executor& execute, size_t chunk_size = parallel_chunk_size);
+
+// On error byte_count is the first problematic byte of the stream
+struct stream_result
+{
+    validation_error error;
+    size_t           byte_count;
+    size_t           codepoint_count;
+};
+
+class stream_validator
+{
+
+public:
+
+    // quick does not check invalid_codepoint and overlong_enocoding
+    explicit stream_validator(bool quick = false) :quick_{ quick } {}
+
+    // the chunk only has to live during the call, after an error the stream
+    // stays failed until reset
+    stream_result feed(byte_range chunk);
+
+    // the end of the stream, unexpected_end if it stopped in a codepoint
+    stream_result finish();
+
+    void reset();
+
+    stream_result result() const { return { error_, byte_count_, codepoint_count_ }; }
+
+private:
+
+    bool             quick_;
+    validation_error error_ = validation_error::success;
+    size_t           byte_count_ = 0;
+    size_t           codepoint_count_ = 0;
+    size_t           pending_size_ = 0;
+    char             pending_[4]{}; // the start of a codepoint the next chunk finishes
+};
+
 } // namespace losgodis::utf8
+
+#if defined(LOSGODIS_HEADER_ONLY)
+#include "../../src/losgodis/utf8.cpp"
+#include "../../src/losgodis/utf8_simd.cpp"
+#endif
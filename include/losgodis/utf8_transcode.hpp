@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+
+    decode_to_utf32 / decode_to_utf16
+
+Decodes a valid utf8 range, like one from validate, it is undefined behaviour
+if it is not. out needs room for count_codepoints(range) codepoints, or
+utf16_length(range) code units, and the number written is returned. Runs of
+ascii are widened 8 bytes at a time in loops the compiler turns into vector
+code, other codepoints are decoded one at a time.
+
+
+    validate_to_utf32 / validate_to_utf16
+
+Validates and decodes in one go, a chunk at a time so the bytes are still in
+cache when they are decoded. out needs room for range.size() code units. On
+error everything up to the first problematic byte has been decoded, and
+transcode_result.byte_count is its offset, same as validate.
+
+
+    encode_utf8
+
+Encodes utf32 or utf16 to utf8, out needs room for utf8_length(in, count)
+bytes, 4 per codepoint or 3 per utf16 code unit is always enough. Invalid
+codepoints and unpaired surrogates are encoded as U+FFFD. Returns the number
+of bytes written.
+
+*/
+
+#include "losgodis/config.hpp"
+#include "losgodis/utf8.hpp"
+
+#include <cstddef>
+
+namespace losgodis::utf8
+{
+
+size_t decode_to_utf32(utf8_range range, codepoint_t* out);
+size_t decode_to_utf16(utf8_range range, char16_t* out);
+
+// the number of utf16 code units range decodes to
+size_t utf16_length(utf8_range range);
+
+struct transcode_result
+{
+    validation_error error;
+    size_t           byte_count; // on error the first problematic byte
+    size_t           written;
+};
+
+transcode_result validate_to_utf32(byte_range range, codepoint_t* out);
+transcode_result validate_to_utf16(byte_range range, char16_t* out);
+
+size_t encode_utf8(const codepoint_t* in, size_t count, char* out);
+size_t encode_utf8(const char16_t* in, size_t count, char* out);
+
+size_t utf8_length(const codepoint_t* in, size_t count);
+size_t utf8_length(const char16_t* in, size_t count);
+
+} // namespace losgodis::utf8
+
+#if defined(LOSGODIS_HEADER_ONLY)
+#include "../../src/losgodis/utf8_transcode.cpp"
+#endif
@@ -0,0 +1,183 @@
+
+#include "losgodis/concurrent_string_pool.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace losgodis
+{
+
+namespace detail
+{
+
+inline constexpr size_t shard_bits = 6;
+inline constexpr size_t shard_count = size_t{ 1 } << shard_bits;
+inline constexpr size_t initial_table_size = 64;
+
+// Written under the shard lock, data last. A reader that sees data can read
+// the rest, and the string bytes it points to.
+struct slot
+{
+    std::atomic<const char*> data{ nullptr };
+    std::atomic<size_t>      size{ 0 };
+    std::atomic<size_t>      hash{ 0 };
+};
+
+// Linear probing table, never shrinks and is replaced by a bigger one when it
+// gets half full. Replaced tables are kept alive since readers can still be
+// probing them, but they will just miss strings added later and fall back to
+// the locked path.
+struct table
+{
+    explicit table(size_t slot_count) :mask{ slot_count - 1 }, slots{ std::make_unique<slot[]>(slot_count) } {}
+
+    const slot* find(std::string_view view, size_t hash) const
+    {
+        for (auto i = hash & mask;; i = (i + 1) & mask)
+        {
+            const auto& s = slots[i];
+            const auto data = s.data.load(std::memory_order_acquire);
+            if (data == nullptr)
+            {
+                return nullptr;
+            }
+            if (s.hash.load(std::memory_order_relaxed) == hash &&
+                s.size.load(std::memory_order_relaxed) == view.size() &&
+                std::string_view{ data, view.size() } == view)
+            {
+                return &s;
+            }
+        }
+    }
+
+    void insert(const char* data, size_t size, size_t hash)
+    {
+        auto i = hash & mask;
+        while (slots[i].data.load(std::memory_order_relaxed) != nullptr)
+        {
+            i = (i + 1) & mask;
+        }
+        auto& s = slots[i];
+        s.size.store(size, std::memory_order_relaxed);
+        s.hash.store(hash, std::memory_order_relaxed);
+        s.data.store(data, std::memory_order_release);
+    }
+
+    size_t slot_count() const { return mask + 1; }
+
+    const size_t                  mask;
+    const std::unique_ptr<slot[]> slots;
+};
+
+} // namespace detail
+
+struct alignas(64) detail::concurrent_string_pool_base::shard
+{
+    std::atomic<table*> current{ nullptr };
+
+    // only touched with the lock held
+    std::mutex                          mutex;
+    std::vector<std::unique_ptr<table>> tables; // back is current
+    size_t                              count = 0;
+    detail::page_allocator              pages;
+
+    shard()
+    {
+        tables.push_back(std::make_unique<table>(initial_table_size));
+        current.store(tables.back().get(), std::memory_order_relaxed);
+    }
+
+    const char* find(std::string_view view, size_t hash) const
+    {
+        const auto s = current.load(std::memory_order_acquire)->find(view, hash);
+        return s != nullptr ? s->data.load(std::memory_order_relaxed) : nullptr;
+    }
+
+    // lock has to be held
+    void insert(const char* data, size_t size, size_t hash)
+    {
+        auto t = tables.back().get();
+        if ((count + 1) * 2 > t->slot_count())
+        {
+            auto bigger = std::make_unique<table>(t->slot_count() * 2);
+            for (size_t i = 0; i < t->slot_count(); ++i)
+            {
+                const auto& s = t->slots[i];
+                if (const auto d = s.data.load(std::memory_order_relaxed))
+                {
+                    bigger->insert(d, s.size.load(std::memory_order_relaxed), s.hash.load(std::memory_order_relaxed));
+                }
+            }
+            t = bigger.get();
+            tables.push_back(std::move(bigger));
+            current.store(t, std::memory_order_release);
+        }
+        t->insert(data, size, hash);
+        count++;
+    }
+};
+
+LOSGODIS_INLINE detail::concurrent_string_pool_base::concurrent_string_pool_base() :
+    shards_{ std::make_unique<shard[]>(shard_count) }
+{
+}
+
+LOSGODIS_INLINE detail::concurrent_string_pool_base::~concurrent_string_pool_base() = default;
+
+LOSGODIS_INLINE detail::concurrent_string_pool_base::shard& detail::concurrent_string_pool_base::get_shard(size_t hash)
+{
+    // the low bits are used inside the shard
+    return shards_[hash >> (sizeof(size_t) * 8 - shard_bits)];
+}
+
+// special one that does not copy
+LOSGODIS_INLINE fixed_string detail::concurrent_string_pool_base::get_literal(std::string_view string, size_t hash)
+{
+    const auto size = string.size();
+    LOSGODIS_TRACE_GET_STRING_BEGIN(string);
+    auto& s = get_shard(hash);
+    if (const auto data = s.find(string, hash))
+    {
+        LOSGODIS_TRACE_GET_STRING_HIT(string);
+        return fixed_string{ data, size };
+    }
+
+    std::lock_guard<std::mutex> lock{ s.mutex };
+    if (const auto data = s.find(string, hash))
+    {
+        LOSGODIS_TRACE_GET_STRING_HIT(string);
+        return fixed_string{ data, size };
+    }
+
+    s.insert(string.data(), size, hash);
+    LOSGODIS_TRACE_GET_STRING_MISS(string);
+    return fixed_string{ string.data(), size };
+}
+
+LOSGODIS_INLINE fixed_string detail::concurrent_string_pool_base::get_string(std::string_view string, size_t hash)
+{
+    const auto size = string.size();
+    LOSGODIS_TRACE_GET_STRING_BEGIN(string);
+    auto& s = get_shard(hash);
+    if (const auto data = s.find(string, hash))
+    {
+        LOSGODIS_TRACE_GET_STRING_HIT(string);
+        return fixed_string{ data, size };
+    }
+
+    std::lock_guard<std::mutex> lock{ s.mutex };
+    if (const auto data = s.find(string, hash))
+    {
+        LOSGODIS_TRACE_GET_STRING_HIT(string);
+        return fixed_string{ data, size };
+    }
+
+    // each shard allocates from its own pages, under the lock it already holds
+    const auto str = s.pages.push_back(string);
+    s.insert(str, size, hash);
+    LOSGODIS_TRACE_GET_STRING_MISS(string);
+    return fixed_string{ str, size };
+}
+
+} // namespace losgodis
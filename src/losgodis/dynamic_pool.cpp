@@ -0,0 +1,226 @@
+
+#include "losgodis/dynamic_pool.hpp"
+
+#include "index_group.hpp"
+
+#include <stdexcept>
+
+namespace losgodis
+{
+
+LOSGODIS_INLINE detail::dynamic_pool_base::dynamic_pool_base(std::pmr::memory_resource* resource) :
+    resource_{ resource },
+    entries_{ resource },
+    pages_{ page_size, max_page_size, resource }
+{
+}
+
+LOSGODIS_INLINE detail::dynamic_pool_base::~dynamic_pool_base()
+{
+    if (groups_ != nullptr)
+    {
+        resource_->deallocate(groups_, group_count_ * sizeof(group), alignof(group));
+    }
+}
+
+LOSGODIS_INLINE const detail::dynamic_pool_base::entry* detail::dynamic_pool_base::get_entry(pooled_string string) const
+{
+    const auto index = string.index();
+    if (string.pool_ != this || index >= entries_.size())
+    {
+        return nullptr;
+    }
+    const auto& e = entries_[index];
+    return e.data != nullptr && e.counter == string.counter() ? &e : nullptr;
+}
+
+LOSGODIS_INLINE uint32_t* detail::dynamic_pool_base::find_slot(std::string_view string, size_t hash) const
+{
+    if (group_count_ == 0)
+    {
+        return nullptr;
+    }
+
+    const auto equal = [this, string, hash](uint32_t index)
+    {
+        const auto& e = entries_[index];
+        return e.hash == hash && e.size == string.size() && std::string_view{ e.data, e.size } == string;
+    };
+    size_t probed_groups;
+    return const_cast<uint32_t*>(detail::find_slot<true>(groups_, group_count_, hash, equal, probed_groups));
+}
+
+LOSGODIS_INLINE pooled_string detail::dynamic_pool_base::find(std::string_view string, size_t hash) const
+{
+    const auto slot = find_slot(string, hash);
+    return slot != nullptr ? handle(*slot) : pooled_string{};
+}
+
+LOSGODIS_INLINE pooled_string detail::dynamic_pool_base::get_string(std::string_view string, size_t hash)
+{
+    if (const auto slot = find_slot(string, hash))
+    {
+        return handle(*slot);
+    }
+
+    if (growth_left_ == 0)
+    {
+        // only grow if it is not the deleted slots that filled the index
+        const auto capacity = group_count_ * string_index::group_size;
+        rehash(group_count_ == 0 ? 1 : size_ * 16 <= capacity * 7 ? group_count_ : group_count_ * 2);
+    }
+
+    uint32_t index = first_free_;
+    if (index != no_entry)
+    {
+        first_free_ = entries_[index].next_free;
+    }
+    else
+    {
+        if (entries_.size() >= no_entry)
+        {
+            throw std::length_error{ "losgodis: dynamic_pool is full" };
+        }
+        index = static_cast<uint32_t>(entries_.size());
+        entries_.push_back({ nullptr, 0, 0, 1, no_entry });
+    }
+
+    // while compacting, the entries the compaction has not reached yet have
+    // their strings in the old pages, it copies them when it gets there
+    auto& e = entries_[index];
+    const auto compacted = new_pages_ && (index < compact_next_ || index >= compact_end_);
+    e.data = compacted ? new_pages_->push_back(string) : pages_.push_back(string);
+    e.size = string.size();
+    e.hash = hash;
+    e.next_free = no_entry;
+
+    insert_slot(groups_, group_count_, hash) = index;
+    growth_left_--;
+    size_++;
+    live_bytes_ += string.size() + 1;
+    return handle(index);
+}
+
+LOSGODIS_INLINE bool detail::dynamic_pool_base::remove_string(std::string_view string, size_t hash)
+{
+    const auto slot = find_slot(string, hash);
+    if (slot == nullptr)
+    {
+        return false;
+    }
+    remove_slot(slot);
+    return true;
+}
+
+LOSGODIS_INLINE bool detail::dynamic_pool_base::remove_string(pooled_string string)
+{
+    const auto e = get_entry(string);
+    if (e == nullptr)
+    {
+        return false;
+    }
+    remove_slot(find_slot(std::string_view{ e->data, e->size }, e->hash));
+    return true;
+}
+
+LOSGODIS_INLINE void detail::dynamic_pool_base::remove_slot(uint32_t* slot)
+{
+    // A group with an empty slot never made a probe go on to the next group,
+    // so the slot can be made empty again. Otherwise it has to stay deleted
+    // for the probes that went past it.
+    const auto offset = reinterpret_cast<const char*>(slot) - reinterpret_cast<const char*>(groups_);
+    auto& grp = groups_[offset / sizeof(group)];
+    const auto shift = (slot - grp.slots) * 8;
+    const auto byte = match_empty_only(grp.control) != 0 ? uint64_t{ 0x80u } : deleted_byte;
+    grp.control = (grp.control & ~(uint64_t{ 0xFFu } << shift)) | (byte << shift);
+    if (byte != deleted_byte)
+    {
+        growth_left_++;
+    }
+
+    const auto index = *slot;
+    auto& e = entries_[index];
+    live_bytes_ -= e.size + 1;
+    size_--;
+    e.data = nullptr;
+    e.counter = e.counter + 1 != 0 ? e.counter + 1 : 1; // 0 is never valid
+    e.next_free = first_free_;
+    first_free_ = index;
+}
+
+LOSGODIS_INLINE void detail::dynamic_pool_base::rehash(size_t group_count)
+{
+    const auto old_groups = groups_;
+    const auto old_group_count = group_count_;
+
+    groups_ = static_cast<group*>(resource_->allocate(group_count * sizeof(group), alignof(group)));
+    for (size_t g = 0; g < group_count; ++g)
+    {
+        groups_[g].control = empty_group;
+    }
+    group_count_ = group_count;
+    growth_left_ = group_count * string_index::group_size * 7 / 8 - size_;
+
+    // the deleted slots are dropped
+    for (size_t g = 0; g < old_group_count; ++g)
+    {
+        const auto& grp = old_groups[g];
+        for (auto used = ~grp.control & high_bits; used != 0; used &= used - 1)
+        {
+            const auto index = grp.slots[first_slot(used)];
+            insert_slot(groups_, group_count_, entries_[index].hash) = index;
+        }
+    }
+    if (old_groups != nullptr)
+    {
+        resource_->deallocate(old_groups, old_group_count * sizeof(group), alignof(group));
+    }
+}
+
+LOSGODIS_INLINE size_t detail::dynamic_pool_base::dead_bytes() const
+{
+    return pages_.bytes_used() + (new_pages_ ? new_pages_->bytes_used() : 0) - live_bytes_;
+}
+
+LOSGODIS_INLINE void detail::dynamic_pool_base::compact()
+{
+    // finishes a compaction in progress, the strings it copied and that were
+    // removed after are holes in its pages, then it takes one more
+    compact_step(SIZE_MAX);
+    if (dead_bytes() != 0)
+    {
+        compact_step(SIZE_MAX);
+    }
+}
+
+LOSGODIS_INLINE bool detail::dynamic_pool_base::compact_step(size_t max_strings)
+{
+    if (!new_pages_)
+    {
+        new_pages_.emplace(page_size, max_page_size, resource_);
+        compact_next_ = 0;
+        compact_end_ = entries_.size();
+    }
+
+    // the entries added after the start are already in the new pages
+    size_t copied = 0;
+    for (; compact_next_ < compact_end_ && copied < max_strings; ++compact_next_)
+    {
+        auto& e = entries_[compact_next_];
+        if (e.data != nullptr)
+        {
+            e.data = new_pages_->push_back(std::string_view{ e.data, e.size });
+            copied++;
+        }
+    }
+    if (compact_next_ < compact_end_)
+    {
+        return false;
+    }
+
+    pages_ = std::move(*new_pages_);
+    new_pages_.reset();
+    return true;
+}
+
+} // namespace losgodis
@@ -0,0 +1,132 @@
+#pragma once
+
+// Internal helpers for the open addressing indexes of string_pool, snapshots,
+// symbol_pool and dynamic_pool. The slots are in groups of 8 with a control
+// byte per slot, either empty, deleted or the low 7 bits of the hash. Only
+// dynamic_pool deletes.
+
+#include "losgodis/string_pool.hpp"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#endif
+#endif
+
+namespace losgodis::detail
+{
+
+// Matching is done on all 8 control bytes of a group at once, in a 64 bit word.
+constexpr uint64_t low_bits = 0x0101010101010101u;
+constexpr uint64_t high_bits = 0x8080808080808080u;
+constexpr uint64_t empty_group = high_bits;
+constexpr uint64_t deleted_byte = 0xFEu;
+
+inline uint64_t control_byte(size_t hash) { return hash & 0x7Fu; }
+inline size_t   group_hash(size_t hash) { return hash >> 7; }
+
+// The high bit is set in every byte that equals byte, might have false
+// positives but they are filtered out when comparing the full hash.
+inline uint64_t match_byte(uint64_t control, uint64_t byte)
+{
+    const auto x = control ^ (low_bits * byte);
+    return (x - low_bits) & ~x & high_bits;
+}
+
+// empty or deleted
+inline uint64_t match_empty(uint64_t control)
+{
+    return control & high_bits;
+}
+
+// empty is 0x80 and deleted 0xFE, bit 1 tells them apart
+inline uint64_t match_empty_only(uint64_t control)
+{
+    return control & ~(control << 6) & high_bits;
+}
+
+inline size_t first_slot(uint64_t mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return index / 8;
+#else
+    return static_cast<size_t>(__builtin_ctzll(mask)) / 8;
+#endif
+}
+
+inline void prefetch_group(const void* grp)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+#if defined(_M_X64) || defined(_M_IX86)
+    _mm_prefetch(reinterpret_cast<const char*>(grp), _MM_HINT_T0);
+#endif
+#else
+    __builtin_prefetch(grp);
+#endif
+}
+
+// Probes for the slot that equal accepts, equal has to check the hash. All
+// indexes have groups of a control word and 8 slots, only the slots differ.
+// A probe can only stop at a deleted slot if the index never deletes.
+template <bool Deletes = false, class Group, class Equal>
+auto find_slot(const Group* groups, size_t group_count, size_t hash, Equal equal, size_t& probed_groups) -> decltype(&groups->slots[0])
+{
+    const auto mask = group_count - 1;
+    const auto byte = control_byte(hash);
+    auto g = group_hash(hash) & mask;
+    for (size_t step = 1;; ++step)
+    {
+        const auto& grp = groups[g];
+        for (auto match = match_byte(grp.control, byte); match != 0; match &= match - 1)
+        {
+            const auto& slot = grp.slots[first_slot(match)];
+            if (equal(slot))
+            {
+                probed_groups = step;
+                return &slot;
+            }
+        }
+        if ((Deletes ? match_empty_only(grp.control) : match_empty(grp.control)) != 0)
+        {
+            probed_groups = step;
+            return nullptr;
+        }
+        g = (g + step) & mask; // triangular probing visits every group
+    }
+}
+
+// Takes the first empty or deleted slot in the probe sequence, there has to be
+// one.
+template <class Group>
+auto insert_slot(Group* groups, size_t group_count, size_t hash) -> decltype(groups->slots[0])
+{
+    const auto mask = group_count - 1;
+    auto g = group_hash(hash) & mask;
+    for (size_t step = 1;; ++step)
+    {
+        auto& grp = groups[g];
+        if (const auto empty = match_empty(grp.control))
+        {
+            const auto slot = first_slot(empty);
+            grp.control = (grp.control & ~(uint64_t{ 0xFFu } << (slot * 8))) | (control_byte(hash) << (slot * 8));
+            return grp.slots[slot];
+        }
+        g = (g + step) & mask;
+    }
+}
+
+// Smallest power of two number of groups that can hold count at load 7/8
+inline size_t group_count_for(size_t count)
+{
+    size_t group_count = 1;
+    while (group_count * string_index::group_size * 7 / 8 < count)
+    {
+        group_count *= 2;
+    }
+    return group_count;
+}
+
+} // namespace losgodis::detail
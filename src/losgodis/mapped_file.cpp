@@ -0,0 +1,179 @@
+#include "losgodis/mapped_file.hpp"
+
+#include <string>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace losgodis
+{
+
+#if defined(_WIN32)
+
+namespace detail
+{
+
+[[noreturn]] LOSGODIS_INLINE void throw_last_error(const char* what, const char* path)
+{
+    throw std::system_error{ static_cast<int>(GetLastError()), std::system_category(), std::string{ what } + " " + path };
+}
+
+} // namespace detail
+
+LOSGODIS_INLINE mapped_file::mapped_file(const char* path)
+{
+    const auto file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        detail::throw_last_error("losgodis: could not open", path);
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        detail::throw_last_error("losgodis: could not get the size of", path);
+    }
+    if (size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return;
+    }
+
+    // the mapping keeps the file open
+    mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping_ == nullptr)
+    {
+        detail::throw_last_error("losgodis: could not map", path);
+    }
+    data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (data_ == nullptr)
+    {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+        detail::throw_last_error("losgodis: could not map", path);
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+}
+
+LOSGODIS_INLINE void mapped_file::unmap() noexcept
+{
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+    }
+}
+
+LOSGODIS_INLINE mapped_file::mapped_file(mapped_file&& other) noexcept :
+    data_{ std::exchange(other.data_, nullptr) },
+    size_{ std::exchange(other.size_, 0) },
+    mapping_{ std::exchange(other.mapping_, nullptr) }
+{
+}
+
+LOSGODIS_INLINE mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+    }
+    return *this;
+}
+
+#else
+
+namespace detail
+{
+
+[[noreturn]] LOSGODIS_INLINE void throw_errno(const char* what, const char* path)
+{
+    throw std::system_error{ errno, std::generic_category(), std::string{ what } + " " + path };
+}
+
+} // namespace detail
+
+LOSGODIS_INLINE mapped_file::mapped_file(const char* path)
+{
+    const auto file = ::open(path, O_RDONLY);
+    if (file == -1)
+    {
+        detail::throw_errno("losgodis: could not open", path);
+    }
+
+    struct stat info;
+    if (::fstat(file, &info) != 0)
+    {
+        const auto error = errno;
+        ::close(file);
+        errno = error;
+        detail::throw_errno("losgodis: could not get the size of", path);
+    }
+    if (info.st_size == 0)
+    {
+        ::close(file);
+        return;
+    }
+
+    // the mapping keeps the file open
+    const auto size = static_cast<size_t>(info.st_size);
+    const auto data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    const auto error = errno;
+    ::close(file);
+    if (data == MAP_FAILED)
+    {
+        errno = error;
+        detail::throw_errno("losgodis: could not map", path);
+    }
+    data_ = data;
+    size_ = size;
+}
+
+LOSGODIS_INLINE void mapped_file::unmap() noexcept
+{
+    if (data_ != nullptr)
+    {
+        ::munmap(const_cast<void*>(data_), size_);
+    }
+}
+
+LOSGODIS_INLINE mapped_file::mapped_file(mapped_file&& other) noexcept :
+    data_{ std::exchange(other.data_, nullptr) },
+    size_{ std::exchange(other.size_, 0) }
+{
+}
+
+LOSGODIS_INLINE mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+#endif
+
+LOSGODIS_INLINE mapped_file::~mapped_file()
+{
+    unmap();
+}
+
+} // namespace losgodis
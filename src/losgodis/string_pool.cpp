@@ -1,61 +1,814 @@
 
 #include "losgodis/string_pool.hpp"
 
+#include "index_group.hpp"
+
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
 namespace losgodis
 {
 
-string_pool::string_pool(std::initializer_list<string_literal> list) :
-    map_{ list.begin(), list.end() }
+// special one that does not copy
+LOSGODIS_INLINE fixed_string detail::string_pool_base::get_literal(std::string_view string, size_t hash)
 {
+    const auto size = string.size();
+    LOSGODIS_TRACE_GET_STRING_BEGIN(string);
+    if (const auto str = snapshot_.find(string, hash))
+    {
+        LOSGODIS_TRACE_GET_STRING_HIT(string);
+        return fixed_string{ str, size };
+    }
+    if (const auto str = index_.find(string, hash))
+    {
+        LOSGODIS_TRACE_GET_STRING_HIT(string);
+        return fixed_string{ str, size };
+    }
+
+    index_.insert({ string.data(), size, hash });
+    string_bytes_ += size;
+    LOSGODIS_TRACE_GET_STRING_MISS(string);
+    return fixed_string{ string.data(), size };
 }
 
-// special one that does not copy
-fixed_string string_pool::get_string(string_literal string)
+LOSGODIS_INLINE fixed_string detail::string_pool_base::get_string(std::string_view string, size_t hash)
+{
+    const auto size = string.size();
+    LOSGODIS_TRACE_GET_STRING_BEGIN(string);
+    if (const auto str = snapshot_.find(string, hash))
+    {
+        LOSGODIS_TRACE_GET_STRING_HIT(string);
+        return fixed_string{ str, size };
+    }
+    if (const auto str = index_.find(string, hash))
+    {
+        LOSGODIS_TRACE_GET_STRING_HIT(string);
+        return fixed_string{ str, size };
+    }
+    return add_string(string, hash);
+}
+
+LOSGODIS_INLINE fixed_string detail::string_pool_base::add_string(std::string_view string, size_t hash)
+{
+    const auto size = string.size();
+    const auto str = pages_.push_back(string);
+    index_.insert({ str, size, hash });
+    string_bytes_ += size;
+    LOSGODIS_TRACE_GET_STRING_MISS(string);
+    return fixed_string{ str, size };
+}
+
+LOSGODIS_INLINE std::optional<fixed_string> detail::string_pool_base::find(std::string_view string, size_t hash) const
 {
-    const auto key = string.key_;
-    const auto size = key.view_.size();
-    const auto it = map_.find(key);
-    if (it != map_.end())
+    if (const auto str = snapshot_.find(string, hash))
     {
-        return fixed_string{ it->view_.data(), size };
+        return fixed_string{ str, string.size() };
     }
+    if (const auto str = index_.find(string, hash))
+    {
+        return fixed_string{ str, string.size() };
+    }
+    return std::nullopt;
+}
+
+LOSGODIS_INLINE pool_stats detail::string_pool_base::stats() const
+{
+    pool_stats stats;
+    stats.string_bytes = string_bytes_;
+    snapshot_.add_stats(stats);
+    index_.add_stats(stats);
+    pages_.add_stats(stats);
+    return stats;
+}
+
+LOSGODIS_INLINE void detail::string_pool_base::write_snapshot(std::ostream& out, uint64_t hash_check) const
+{
+    std::vector<string_index::entry> entries;
+    append_entries(entries);
+    snapshot_index::write(out, entries, hash_check);
+}
 
-    map_.insert(string_key{ key.view_ , key.hash_ });
-    return fixed_string{ key.view_.data(), size };
+LOSGODIS_INLINE void detail::string_pool_base::append_entries(std::vector<string_index::entry>& entries) const
+{
+    snapshot_.append_entries(entries);
+    index_.append_entries(entries);
 }
 
-fixed_string string_pool::get_string(string_key key)
+// the entries of other point into its pages and snapshot, they are added as
+// they are and then the pages are moved over
+LOSGODIS_INLINE void detail::string_pool_base::merge(string_pool_base& other)
 {
-    const auto size = key.view_.size();
-    const auto it = map_.find(key);
-    if (it != map_.end())
+    if (&other == this)
     {
-        return fixed_string{ it->view_.data(), size };
+        return;
     }
 
-    if (page_ == nullptr || !page_->can_hold(size))
+    std::vector<string_index::entry> entries;
+    other.append_entries(entries);
+    index_.reserve(index_.size() + entries.size());
+    for (const auto& e : entries)
     {
-        page_ = std::make_unique<detail::fixed_page>(std::move(page_));
+        const std::string_view string{ e.data, e.size };
+        if (snapshot_.find(string, e.hash) == nullptr && index_.find(string, e.hash) == nullptr)
+        {
+            index_.insert(e);
+            string_bytes_ += e.size;
+        }
     }
+    pages_.splice(other.pages_);
 
-    const auto str = page_->push_back(key);
-    map_.insert(string_key{ std::string_view{ str, size }, key.hash_ });
-    return fixed_string{ str, size };
+    other.snapshot_ = snapshot_index{};
+    other.index_.clear();
+    other.string_bytes_ = 0;
+    other.clear_count_++;
 }
 
-bool detail::fixed_page::can_hold(size_t size)
+LOSGODIS_INLINE void detail::string_pool_base::clear()
 {
-    return (size + 1) < remaining_;
+    index_.clear();
+    pages_.clear();
+    string_bytes_ = 0;
+    clear_count_++;
 }
 
-const char* detail::fixed_page::push_back(string_key key)
+LOSGODIS_INLINE void detail::page_deleter::operator()(fixed_page* page) const
 {
-    const auto size = key.view().size();
-    const auto start = &buffer_.back() - remaining_ + 1;
-    key.view().copy(start, size);
+    const auto bytes = sizeof(fixed_page) + page->capacity_;
+    page->~fixed_page();
+    resource->deallocate(page, bytes, alignof(fixed_page));
+}
+
+LOSGODIS_INLINE detail::page_ptr detail::fixed_page::create(size_t capacity, std::pmr::memory_resource* resource)
+{
+    const auto memory = resource->allocate(sizeof(fixed_page) + capacity, alignof(fixed_page));
+    LOSGODIS_TRACE_PAGE_ALLOCATION(sizeof(fixed_page) + capacity);
+    return page_ptr{ new (memory) fixed_page{ capacity }, page_deleter{ resource } };
+}
+
+LOSGODIS_INLINE bool detail::fixed_page::can_hold(size_t size) const
+{
+    return size < remaining_;
+}
+
+LOSGODIS_INLINE const char* detail::fixed_page::push_back(std::string_view string)
+{
+    const auto size = string.size();
+    const auto start = buffer() + (capacity_ - remaining_);
+    string.copy(start, size);
     start[size] = '\0';
     remaining_ -= size + 1;
     return start;
 }
 
+LOSGODIS_INLINE detail::page_allocator::page_allocator(size_t first_page_size, size_t max_page_size, std::pmr::memory_resource* resource) :
+    resource_{ resource },
+    pages_{ resource },
+    dedicated_pages_{ resource },
+    next_page_size_{ first_page_size > 0 ? first_page_size : 1 },
+    max_page_size_{ max_page_size > next_page_size_ ? max_page_size : next_page_size_ }
+{
+}
+
+LOSGODIS_INLINE const char* detail::page_allocator::push_back(std::string_view string)
+{
+    const auto size = string.size();
+    page_bytes_used_ += size + 1;
+    if (current_ < pages_.size() && pages_[current_]->can_hold(size))
+    {
+        return pages_[current_]->push_back(string);
+    }
+
+    // a quarter of a page or more is not worth starting a new page for
+    if (size >= next_page_size_ / 4)
+    {
+        page_count_++;
+        page_bytes_ += size + 1;
+        dedicated_pages_.push_back(fixed_page::create(size + 1, resource_));
+        return dedicated_pages_.back()->push_back(string);
+    }
+
+    // pages kept by clear are filled before new ones are made
+    while (current_ + 1 < pages_.size())
+    {
+        if (pages_[++current_]->can_hold(size))
+        {
+            return pages_[current_]->push_back(string);
+        }
+    }
+
+    page_count_++;
+    page_bytes_ += next_page_size_;
+    pages_.push_back(fixed_page::create(next_page_size_, resource_));
+    current_ = pages_.size() - 1;
+    next_page_size_ = next_page_size_ < max_page_size_ / growth_factor ? next_page_size_ * growth_factor : max_page_size_;
+    return pages_[current_]->push_back(string);
+}
+
+// the current page stays current, other starts over with no pages
+LOSGODIS_INLINE void detail::page_allocator::splice(page_allocator& other)
+{
+    for (auto* pages : { &other.pages_, &other.dedicated_pages_ })
+    {
+        for (auto& page : *pages)
+        {
+            dedicated_pages_.push_back(std::move(page));
+        }
+        pages->clear();
+    }
+    other.current_ = 0;
+
+    page_count_ += other.page_count_;
+    page_bytes_ += other.page_bytes_;
+    page_bytes_used_ += other.page_bytes_used_;
+    other.page_count_ = 0;
+    other.page_bytes_ = 0;
+    other.page_bytes_used_ = 0;
+}
+
+LOSGODIS_INLINE void detail::page_allocator::clear()
+{
+    for (const auto& page : dedicated_pages_)
+    {
+        page_bytes_ -= page->capacity();
+    }
+    page_count_ -= dedicated_pages_.size();
+    dedicated_pages_.clear();
+
+    for (const auto& page : pages_)
+    {
+        page->clear();
+    }
+    current_ = 0;
+    page_bytes_used_ = 0;
+}
+
+LOSGODIS_INLINE void detail::page_allocator::add_stats(pool_stats& stats) const
+{
+    stats.page_count += page_count_;
+    stats.page_bytes += page_bytes_;
+    stats.page_bytes_used += page_bytes_used_;
+}
+
+namespace detail
+{
+
+inline constexpr uint64_t long_string_tag = uint64_t{ 0xFF } << 56;
+
+// The slot words of a string, see string_index::slot. The reads cover all the
+// bytes of a short string, overlapping where they have to.
+inline void slot_words(const char* data, size_t size, size_t hash, uint64_t (&words)[2])
+{
+    if (size >= 16)
+    {
+        words[0] = hash;
+        words[1] = size | long_string_tag;
+    }
+    else if (size >= 8)
+    {
+        words[0] = read_u64(data);
+        words[1] = (size == 8 ? 0 : read_u64(data + size - 8) >> (8 * (16 - size))) | (uint64_t{ size } << 56);
+    }
+    else if (size >= 4)
+    {
+        words[0] = read_u32(data) | ((read_u32(data + size - 4) >> (8 * (8 - size))) << 32);
+        words[1] = uint64_t{ size } << 56;
+    }
+    else
+    {
+        words[0] = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            words[0] |= read_u8(data + i) << (8 * i);
+        }
+        words[1] = uint64_t{ size } << 56;
+    }
+}
+
+inline bool is_long_slot(const uint64_t (&words)[2])
+{
+    return (words[1] & long_string_tag) == long_string_tag;
+}
+
+} // namespace detail
+
+LOSGODIS_INLINE detail::string_index::slot detail::string_index::make_slot(const entry& e)
+{
+    slot s{ {}, e.data };
+    slot_words(e.data, e.size, e.hash, s.words);
+    return s;
+}
+
+LOSGODIS_INLINE detail::string_index::entry detail::string_index::make_entry(const slot& s) const
+{
+    if (is_long_slot(s.words))
+    {
+        return { s.data, static_cast<size_t>(s.words[1] & ~long_string_tag), static_cast<size_t>(s.words[0]) };
+    }
+
+    const auto size = static_cast<size_t>(s.words[1] >> 56);
+    return { s.data, size, hash_(s.data, size) };
+}
+
+LOSGODIS_INLINE const char* detail::string_index::find(std::string_view view, size_t hash) const
+{
+    if (group_count_ == 0)
+    {
+        count_lookup(false, 0);
+        return nullptr;
+    }
+
+    // the words of a short string are the whole string, the hash is only
+    // compared for long strings
+    uint64_t words[2];
+    slot_words(view.data(), view.size(), hash, words);
+    const auto equal = [view, &words](const slot& s)
+    {
+        return s.words[0] == words[0] && s.words[1] == words[1] &&
+            (view.size() <= max_inline_size || std::memcmp(s.data, view.data(), view.size()) == 0);
+    };
+    size_t probed_groups;
+    auto s = find_slot(groups_, group_count_, hash, equal, probed_groups);
+    if (s == nullptr && old_groups_ != nullptr)
+    {
+        size_t old_probed_groups;
+        s = find_slot(old_groups_, old_group_count_, hash, equal, old_probed_groups);
+        probed_groups += old_probed_groups;
+    }
+    count_lookup(s != nullptr, probed_groups);
+    return s != nullptr ? s->data : nullptr;
+}
+
+LOSGODIS_INLINE void detail::string_index::add_stats(pool_stats& stats) const
+{
+    stats.string_count += size_;
+    stats.index_capacity += capacity();
+#if defined(LOSGODIS_STRING_POOL_STATS)
+    stats.lookups += counters_.lookups;
+    stats.hits += counters_.hits;
+    stats.probed_groups += counters_.probed_groups;
+    stats.max_probed_groups = counters_.max_probed_groups > stats.max_probed_groups ? counters_.max_probed_groups : stats.max_probed_groups;
+#endif
+}
+
+LOSGODIS_INLINE void detail::string_index::prefetch(size_t hash) const
+{
+    if (group_count_ == 0)
+    {
+        return;
+    }
+
+    prefetch_group(&groups_[group_hash(hash) & (group_count_ - 1)]);
+    if (old_groups_ != nullptr)
+    {
+        prefetch_group(&old_groups_[group_hash(hash) & (old_group_count_ - 1)]);
+    }
+}
+
+LOSGODIS_INLINE void detail::string_index::insert(const entry& e)
+{
+    if (old_groups_ != nullptr)
+    {
+        move_groups(groups_per_insert);
+    }
+    else if (next_groups_ != nullptr)
+    {
+        clear_groups(groups_per_insert);
+    }
+    else if (growth_left_ <= group_count_ && group_count_ >= incremental_group_count)
+    {
+        // clearing takes as many inserts as there are slots left, after a
+        // reserve there can be fewer and the rest is cleared by the rehash
+        next_group_count_ = group_count_ * 2;
+        next_groups_ = allocate_groups(next_group_count_);
+    }
+    if (growth_left_ == 0)
+    {
+        rehash(group_count_ == 0 ? 1 : group_count_ * 2, next_groups_ != nullptr);
+    }
+
+    insert_slot(make_slot(e), e.hash);
+}
+
+LOSGODIS_INLINE void detail::string_index::insert_slot(const slot& s, size_t hash)
+{
+    detail::insert_slot(groups_, group_count_, hash) = s;
+    size_++;
+    growth_left_--;
+}
+
+LOSGODIS_INLINE void detail::string_index::reserve(size_t count)
+{
+    // keep the load factor at most 7/8
+    const auto group_count = group_count_for(count);
+    if (group_count > group_count_)
+    {
+        rehash(group_count, false);
+    }
+}
+
+LOSGODIS_INLINE void detail::string_index::clear()
+{
+    // the strings that are not moved yet are dropped with the old groups
+    deallocate_groups(old_groups_, old_group_count_);
+    old_groups_ = nullptr;
+    old_group_count_ = 0;
+    moved_groups_ = 0;
+    deallocate_groups(next_groups_, next_group_count_);
+    next_groups_ = nullptr;
+    next_group_count_ = 0;
+    cleared_groups_ = 0;
+
+    for (size_t g = 0; g < group_count_; ++g)
+    {
+        groups_[g].control = empty_group;
+    }
+    size_ = 0;
+    growth_left_ = group_count_ * group_size * 7 / 8;
+}
+
+LOSGODIS_INLINE void detail::string_index::append_entries(std::vector<entry>& entries) const
+{
+    const auto append = [this, &entries](const group* groups, size_t first, size_t last)
+    {
+        for (size_t g = first; g < last; ++g)
+        {
+            const auto& grp = groups[g];
+            for (auto used = ~grp.control & high_bits; used != 0; used &= used - 1)
+            {
+                entries.push_back(make_entry(grp.slots[first_slot(used)]));
+            }
+        }
+    };
+    append(groups_, 0, group_count_);
+    append(old_groups_, moved_groups_, old_group_count_);
+}
+
+LOSGODIS_INLINE detail::string_index::~string_index()
+{
+    deallocate_groups(groups_, group_count_);
+    deallocate_groups(next_groups_, next_group_count_);
+    deallocate_groups(old_groups_, old_group_count_);
+}
+
+LOSGODIS_INLINE detail::string_index::group* detail::string_index::allocate_groups(size_t count)
+{
+    return static_cast<group*>(resource_->allocate(count * sizeof(group), alignof(group)));
+}
+
+LOSGODIS_INLINE void detail::string_index::deallocate_groups(group* groups, size_t count)
+{
+    if (groups != nullptr)
+    {
+        resource_->deallocate(groups, count * sizeof(group), alignof(group));
+    }
+}
+
+LOSGODIS_INLINE void detail::string_index::rehash(size_t group_count, bool incremental)
+{
+    // there is only room for one old index
+    if (old_groups_ != nullptr)
+    {
+        move_groups(old_group_count_);
+    }
+    // reserve can ask for more than was prepared
+    if (next_group_count_ != group_count)
+    {
+        deallocate_groups(next_groups_, next_group_count_);
+        next_groups_ = allocate_groups(group_count);
+        next_group_count_ = group_count;
+        cleared_groups_ = 0;
+    }
+    clear_groups(next_group_count_);
+
+    old_groups_ = groups_;
+    old_group_count_ = group_count_;
+    moved_groups_ = 0;
+    groups_ = next_groups_;
+    group_count_ = next_group_count_;
+    next_groups_ = nullptr;
+    next_group_count_ = 0;
+    cleared_groups_ = 0;
+    // the strings in the old groups are already counted, and the move is done
+    // long before the rest of the new groups are used
+    growth_left_ = group_count_ * group_size * 7 / 8 - size_;
+
+    if (!incremental)
+    {
+        move_groups(old_group_count_);
+    }
+}
+
+LOSGODIS_INLINE void detail::string_index::clear_groups(size_t count)
+{
+    const auto last = next_group_count_ - cleared_groups_ > count ? cleared_groups_ + count : next_group_count_;
+    for (auto g = cleared_groups_; g < last; ++g)
+    {
+        next_groups_[g].control = empty_group;
+    }
+    cleared_groups_ = last;
+}
+
+// only short strings are rehashed, they are small and packed in the pages
+LOSGODIS_INLINE void detail::string_index::move_groups(size_t count)
+{
+    const auto last = old_group_count_ - moved_groups_ > count ? moved_groups_ + count : old_group_count_;
+    for (auto g = moved_groups_; g < last; ++g)
+    {
+        const auto& grp = old_groups_[g];
+        for (auto used = ~grp.control & high_bits; used != 0; used &= used - 1)
+        {
+            const auto& s = grp.slots[first_slot(used)];
+            detail::insert_slot(groups_, group_count_, make_entry(s).hash) = s;
+        }
+    }
+    moved_groups_ = last;
+
+    if (moved_groups_ == old_group_count_)
+    {
+        deallocate_groups(old_groups_, old_group_count_);
+        old_groups_ = nullptr;
+        old_group_count_ = 0;
+        moved_groups_ = 0;
+    }
+}
+
+namespace detail
+{
+
+// First in a snapshot, followed by the groups and then the null terminated
+// strings. All offsets are from the start of the snapshot.
+struct snapshot_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t hash_check;
+    uint64_t string_count;
+    uint64_t string_bytes;
+    uint64_t group_count;
+    uint64_t strings_offset;
+    uint64_t size;
+};
+
+inline constexpr char     snapshot_magic[8] = { 'l', 'o', 's', 'g', 'o', 'd', 'i', 's' };
+inline constexpr uint32_t snapshot_version = 1;
+inline constexpr uint32_t snapshot_byte_order = 0x01020304u;
+
+} // namespace detail
+
+LOSGODIS_INLINE detail::snapshot_index::snapshot_index(string_pool_snapshot snapshot, uint64_t hash_check)
+{
+    const auto invalid = [](const char* what) { throw std::invalid_argument{ std::string{ "losgodis: string_pool snapshot " } + what }; };
+
+    if (snapshot.size < sizeof(snapshot_header))
+    {
+        invalid("is too small");
+    }
+    if (reinterpret_cast<uintptr_t>(snapshot.data) % alignof(snapshot_header) != 0)
+    {
+        invalid("is not aligned");
+    }
+
+    const auto& header = *static_cast<const snapshot_header*>(snapshot.data);
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0 || header.version != snapshot_version)
+    {
+        invalid("has the wrong format");
+    }
+    if (header.byte_order != snapshot_byte_order)
+    {
+        invalid("has the wrong byte order");
+    }
+    if (header.hash_check != hash_check)
+    {
+        invalid("has another hash policy");
+    }
+    const auto group_count = header.group_count;
+    if (header.size != snapshot.size || group_count == 0 || (group_count & (group_count - 1)) != 0 ||
+        group_count > (snapshot.size - sizeof(snapshot_header)) / sizeof(group) ||
+        header.strings_offset < sizeof(snapshot_header) + group_count * sizeof(group) ||
+        header.strings_offset > snapshot.size)
+    {
+        invalid("is truncated or corrupt");
+    }
+
+    data_ = static_cast<const char*>(snapshot.data);
+    groups_ = reinterpret_cast<const group*>(data_ + sizeof(snapshot_header));
+
+    // Every slot has to be a string in the string part, with its terminator,
+    // and there has to be an empty slot for a probe to stop at. This reads the
+    // groups but not the strings, the last byte ends the last string.
+    uint64_t string_count = 0;
+    uint64_t string_bytes = 0;
+    bool has_empty_slot = false;
+    for (size_t g = 0; g < group_count; ++g)
+    {
+        const auto& grp = groups_[g];
+        for (size_t i = 0; i < string_index::group_size; ++i)
+        {
+            const auto control = (grp.control >> (i * 8)) & 0xFFu;
+            const auto& slot = grp.slots[i];
+            if (control == 0x80u)
+            {
+                has_empty_slot = true;
+            }
+            else if (control != control_byte(static_cast<size_t>(slot.hash)) ||
+                slot.offset < header.strings_offset || slot.offset >= snapshot.size || slot.size >= snapshot.size - slot.offset)
+            {
+                invalid("is truncated or corrupt");
+            }
+            else
+            {
+                string_count++;
+                string_bytes += slot.size;
+            }
+        }
+    }
+    if (!has_empty_slot || string_count != header.string_count || string_bytes != header.string_bytes ||
+        (string_count != 0 && data_[snapshot.size - 1] != '\0'))
+    {
+        invalid("is truncated or corrupt");
+    }
+
+    group_count_ = static_cast<size_t>(group_count);
+    size_ = static_cast<size_t>(header.string_count);
+    string_bytes_ = static_cast<size_t>(header.string_bytes);
+}
+
+LOSGODIS_INLINE const char* detail::snapshot_index::find_string(std::string_view view, size_t hash) const
+{
+    const auto equal = [this, view, hash](const slot& s) { return s.hash == hash && s.size == view.size() && std::string_view{ data_ + s.offset, view.size() } == view; };
+    size_t probed_groups;
+    const auto s = find_slot(groups_, group_count_, hash, equal, probed_groups);
+    return s != nullptr ? data_ + s->offset : nullptr;
+}
+
+LOSGODIS_INLINE void detail::snapshot_index::prefetch(size_t hash) const
+{
+    if (group_count_ != 0)
+    {
+        prefetch_group(&groups_[group_hash(hash) & (group_count_ - 1)]);
+    }
+}
+
+LOSGODIS_INLINE void detail::snapshot_index::add_stats(pool_stats& stats) const
+{
+    stats.string_count += size_;
+    stats.string_bytes += string_bytes_;
+    stats.index_capacity += group_count_ * string_index::group_size;
+}
+
+LOSGODIS_INLINE void detail::snapshot_index::append_entries(std::vector<string_index::entry>& entries) const
+{
+    for (size_t g = 0; g < group_count_; ++g)
+    {
+        const auto& grp = groups_[g];
+        for (auto used = ~grp.control & high_bits; used != 0; used &= used - 1)
+        {
+            const auto& s = grp.slots[first_slot(used)];
+            entries.push_back({ data_ + s.offset, static_cast<size_t>(s.size), static_cast<size_t>(s.hash) });
+        }
+    }
+}
+
+namespace detail
+{
+
+struct snapshot_layout
+{
+    snapshot_header                          header;
+    std::vector<snapshot_index::group>       groups;
+    std::vector<const string_index::entry*>  strings; // in the order they are stored
+};
+
+// The strings are stored in the order of their slots, roughly sorted by hash,
+// so a lookup and the ones probing nearby groups read nearby strings.
+inline snapshot_layout layout_snapshot(const std::vector<string_index::entry>& entries, uint64_t hash_check)
+{
+    using group = snapshot_index::group;
+
+    snapshot_layout layout;
+    const auto group_count = group_count_for(entries.size());
+    layout.groups.resize(group_count);
+    for (auto& grp : layout.groups)
+    {
+        grp.control = empty_group;
+    }
+
+    // offset is the index of the entry until the strings are placed
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const auto& e = entries[i];
+        insert_slot(layout.groups.data(), group_count, e.hash) = snapshot_index::slot{ i, e.size, e.hash };
+    }
+
+    const uint64_t strings_offset = sizeof(snapshot_header) + group_count * sizeof(group);
+    uint64_t offset = strings_offset;
+    uint64_t string_bytes = 0;
+    layout.strings.reserve(entries.size());
+    for (auto& grp : layout.groups)
+    {
+        for (auto used = ~grp.control & high_bits; used != 0; used &= used - 1)
+        {
+            auto& s = grp.slots[first_slot(used)];
+            layout.strings.push_back(&entries[static_cast<size_t>(s.offset)]);
+            s.offset = offset;
+            offset += s.size + 1;
+            string_bytes += s.size;
+        }
+    }
+
+    auto& header = layout.header;
+    header = {};
+    std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.version = snapshot_version;
+    header.byte_order = snapshot_byte_order;
+    header.hash_check = hash_check;
+    header.string_count = entries.size();
+    header.string_bytes = string_bytes;
+    header.group_count = group_count;
+    header.strings_offset = strings_offset;
+    header.size = offset;
+    return layout;
+}
+
+} // namespace detail
+
+LOSGODIS_INLINE void detail::snapshot_index::write(std::ostream& out, const std::vector<string_index::entry>& entries, uint64_t hash_check)
+{
+    const auto layout = layout_snapshot(entries, hash_check);
+    out.write(reinterpret_cast<const char*>(&layout.header), sizeof(layout.header));
+    out.write(reinterpret_cast<const char*>(layout.groups.data()), static_cast<std::streamsize>(layout.groups.size() * sizeof(group)));
+    for (const auto e : layout.strings)
+    {
+        out.write(e->data, static_cast<std::streamsize>(e->size));
+        out.put('\0');
+    }
+}
+
+LOSGODIS_INLINE string_pool_snapshot detail::snapshot_index::write(const std::vector<string_index::entry>& entries, uint64_t hash_check, std::pmr::memory_resource* resource)
+{
+    const auto layout = layout_snapshot(entries, hash_check);
+    const auto size = static_cast<size_t>(layout.header.size);
+    const auto memory = static_cast<char*>(resource->allocate(size, alignof(snapshot_header)));
+
+    auto out = memory;
+    std::memcpy(out, &layout.header, sizeof(layout.header));
+    out += sizeof(layout.header);
+    std::memcpy(out, layout.groups.data(), layout.groups.size() * sizeof(group));
+    out += layout.groups.size() * sizeof(group);
+    for (const auto e : layout.strings)
+    {
+        std::memcpy(out, e->data, e->size);
+        out[e->size] = '\0';
+        out += e->size + 1;
+    }
+    return { memory, size };
+}
+
+LOSGODIS_INLINE detail::frozen_string_pool_base::frozen_string_pool_base(const std::vector<string_index::entry>& entries, uint64_t hash_check, std::pmr::memory_resource* resource) :
+    resource_{ resource },
+    memory_{ snapshot_index::write(entries, hash_check, resource) },
+    index_{ memory_, hash_check }
+{
+}
+
+LOSGODIS_INLINE detail::frozen_string_pool_base::frozen_string_pool_base(frozen_string_pool_base&& other) noexcept :
+    resource_{ other.resource_ },
+    memory_{ other.memory_ },
+    index_{ other.index_ }
+{
+    other.memory_ = {};
+    other.index_ = snapshot_index{};
+}
+
+LOSGODIS_INLINE detail::frozen_string_pool_base::~frozen_string_pool_base()
+{
+    if (memory_.data != nullptr)
+    {
+        resource_->deallocate(const_cast<void*>(memory_.data), memory_.size, alignof(snapshot_header));
+    }
+}
+
+LOSGODIS_INLINE std::optional<fixed_string> detail::frozen_string_pool_base::find(std::string_view string, size_t hash) const
+{
+    if (const auto str = index_.find(string, hash))
+    {
+        return fixed_string{ str, string.size() };
+    }
+    return std::nullopt;
+}
+
+LOSGODIS_INLINE pool_stats detail::frozen_string_pool_base::stats() const
+{
+    pool_stats stats;
+    index_.add_stats(stats);
+    return stats;
+}
+
+LOSGODIS_INLINE void detail::frozen_string_pool_base::write_snapshot(std::ostream& out) const
+{
+    out.write(static_cast<const char*>(memory_.data), static_cast<std::streamsize>(memory_.size));
+}
+
 } // namespace losgodis
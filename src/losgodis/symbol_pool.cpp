@@ -0,0 +1,116 @@
+
+#include "losgodis/symbol_pool.hpp"
+
+#include "index_group.hpp"
+
+#include <stdexcept>
+
+namespace losgodis
+{
+
+LOSGODIS_INLINE detail::symbol_pool_base::symbol_pool_base(std::pmr::memory_resource* resource) :
+    resource_{ resource },
+    chars_{ resource },
+    offsets_{ 1, 0, resource },
+    hashes_{ resource }
+{
+}
+
+LOSGODIS_INLINE detail::symbol_pool_base::~symbol_pool_base()
+{
+    if (groups_ != nullptr)
+    {
+        resource_->deallocate(groups_, group_count_ * sizeof(group), alignof(group));
+    }
+}
+
+LOSGODIS_INLINE symbol detail::symbol_pool_base::find(std::string_view string, size_t hash) const
+{
+    if (group_count_ == 0)
+    {
+        return symbol{};
+    }
+
+    const auto equal = [this, string, hash](uint32_t id) { return hashes_[id] == hash && view(symbol{ id }) == string; };
+    size_t probed_groups;
+    const auto id = find_slot(groups_, group_count_, hash, equal, probed_groups);
+    return id != nullptr ? symbol{ *id } : symbol{};
+}
+
+LOSGODIS_INLINE symbol detail::symbol_pool_base::get_symbol(std::string_view string, size_t hash)
+{
+    const auto found = find(string, hash);
+    if (found.valid())
+    {
+        return found;
+    }
+
+    const auto id = size();
+    if (id >= symbol::invalid_id)
+    {
+        throw std::length_error{ "losgodis: symbol_pool is full" };
+    }
+    if (growth_left_ == 0)
+    {
+        rehash(group_count_ == 0 ? 1 : group_count_ * 2);
+    }
+
+    // the arrays are put back to the size of id if one of them fails to grow
+    const auto chars_size = chars_.size();
+    try
+    {
+        chars_.insert(chars_.end(), string.begin(), string.end());
+        chars_.push_back('\0');
+        offsets_.push_back(chars_.size());
+        hashes_.push_back(hash);
+    }
+    catch (...)
+    {
+        chars_.resize(chars_size);
+        offsets_.resize(id + 1);
+        hashes_.resize(id);
+        throw;
+    }
+
+    insert_slot(groups_, group_count_, hash) = static_cast<uint32_t>(id);
+    growth_left_--;
+    return symbol{ static_cast<uint32_t>(id) };
+}
+
+LOSGODIS_INLINE void detail::symbol_pool_base::reserve(size_t count, size_t bytes)
+{
+    chars_.reserve(bytes + count);
+    offsets_.reserve(count + 1);
+    hashes_.reserve(count);
+    const auto group_count = group_count_for(count);
+    if (group_count > group_count_)
+    {
+        rehash(group_count);
+    }
+}
+
+// the new groups are filled before the old ones are freed, so the pool is
+// unchanged if the allocation throws
+LOSGODIS_INLINE void detail::symbol_pool_base::rehash(size_t group_count)
+{
+    const auto groups = static_cast<group*>(resource_->allocate(group_count * sizeof(group), alignof(group)));
+    for (size_t g = 0; g < group_count; ++g)
+    {
+        groups[g].control = empty_group;
+    }
+    // the symbols are dense so they are reinserted from the hashes
+    for (size_t id = 0; id < size(); ++id)
+    {
+        insert_slot(groups, group_count, hashes_[id]) = static_cast<uint32_t>(id);
+    }
+
+    if (groups_ != nullptr)
+    {
+        resource_->deallocate(groups_, group_count_ * sizeof(group), alignof(group));
+    }
+    groups_ = groups;
+    group_count_ = group_count;
+    growth_left_ = group_count * string_index::group_size * 7 / 8 - size();
+}
+
+} // namespace losgodis
@@ -0,0 +1,55 @@
+#include "losgodis/thread_cache.hpp"
+
+#include <atomic>
+#include <cstring>
+
+namespace losgodis
+{
+
+namespace detail
+{
+
+// Zero initialized, owner 0 is an empty entry. No constructor so the
+// thread_local needs no guard.
+struct thread_cache_entry
+{
+    uint64_t    owner;
+    uint64_t    clear_count;
+    size_t      hash;
+    const char* data;
+    size_t      size;
+};
+
+inline thread_cache_entry& thread_cache_entry_for(size_t hash)
+{
+    thread_local thread_cache_entry entries[thread_cache_base::cache_size];
+    return entries[hash & (thread_cache_base::cache_size - 1)];
+}
+
+inline std::atomic<uint64_t> next_thread_cache_id{ 1 };
+
+} // namespace detail
+
+LOSGODIS_INLINE detail::thread_cache_base::thread_cache_base() :
+    id_{ next_thread_cache_id.fetch_add(1, std::memory_order_relaxed) }
+{
+}
+
+LOSGODIS_INLINE std::optional<fixed_string> detail::thread_cache_base::find(std::string_view string, size_t hash, uint64_t clear_count) const
+{
+    // the owner and the clear_count are checked first, the data of other
+    // owners and of before a clear may be gone
+    const auto& e = thread_cache_entry_for(hash);
+    if (e.owner == id_ && e.clear_count == clear_count && e.hash == hash && e.size == string.size() && std::memcmp(e.data, string.data(), string.size()) == 0)
+    {
+        return fixed_string{ e.data, e.size };
+    }
+    return std::nullopt;
+}
+
+LOSGODIS_INLINE void detail::thread_cache_base::store(fixed_string string, size_t hash, uint64_t clear_count) const
+{
+    thread_cache_entry_for(hash) = { id_, clear_count, hash, string.data(), string.size() };
+}
+
+} // namespace losgodis
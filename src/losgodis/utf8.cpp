@@ -1,134 +1,518 @@
 ﻿
 #include "losgodis/utf8.hpp"
 
+#include "utf8_simd.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <vector>
+
 namespace losgodis::utf8
 {
 
-validation_result validate(byte_range range)
+namespace detail
 {
-    size_t codepoint_count = 0;
-    size_t i = 0;
-    while (i < range.size())
+
+struct scan_result
+{
+    validation_error error;
+    size_t           end; // on error the first problematic byte
+    size_t           codepoint_count;
+};
+
+LOSGODIS_INLINE uint64_t load_word(const char* data)
+{
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+// Skips ascii a word at a time, returns the first byte that is not ascii or
+// the start of the last few bytes if they are too few to make a word.
+LOSGODIS_INLINE size_t skip_ascii(byte_range range, size_t i)
+{
+    constexpr uint64_t high_bits = 0x8080808080808080u;
+
+    const auto data = range.begin();
+    while (range.size() - i >= 32)
+    {
+        const auto word = load_word(data + i) | load_word(data + i + 8) | load_word(data + i + 16) | load_word(data + i + 24);
+        if (word & high_bits) { break; }
+        i += 32;
+    }
+    while (range.size() - i >= 8)
+    {
+        if (load_word(data + i) & high_bits) { break; }
+        i += 8;
+    }
+    return i;
+}
+
+// Validates from i, that has to be at a codepoint boundary, until the first
+// codepoint boundary at or after stop.
+template <bool Quick>
+scan_result validate_scalar(byte_range range, size_t i, size_t codepoint_count, size_t stop)
+{
+    while (i < stop)
     {
         const auto b1 = range[i];
         if (b1 < 0x80u) // 0xxxxxxx
         {
-            i++;
-            codepoint_count++;
+            const auto ascii_end = skip_ascii(range, i + 1);
+            codepoint_count += ascii_end - i;
+            i = ascii_end;
         }
         else if (b1 < 0xC0u) // 10xxxxxx continuation byte
         {
-            return { validation_error::unexpected_continuation_byte, range.to_utf8(i), codepoint_count };
+            return { validation_error::unexpected_continuation_byte, i, codepoint_count };
         }
         else if (b1 < 0xE0u) // 110xxxxx 10xxxxxx
         {
-            if (i + 1 >= range.size()) { return { validation_error::unexpected_end, range.to_utf8(i), codepoint_count }; }
+            if (i + 1 >= range.size()) { return { validation_error::unexpected_end, i, codepoint_count }; }
 
             const auto b2 = range[i + 1];
-            if ((b2 ^ 0x80u) & 0xC0u) { return { validation_error::unexpected_non_continuation_byte, range.to_utf8(i), codepoint_count }; }
+            if ((b2 ^ 0x80u) & 0xC0u) { return { validation_error::unexpected_non_continuation_byte, i, codepoint_count }; }
 
-            uint32_t codepoint = ((b1 & 0x1Fu) << 6) | (b2 & 0x3Fu);
-            if (codepoint < 0x7Fu) { return { validation_error::overlong_enocoding, range.to_utf8(i), codepoint_count }; }
+            if constexpr (!Quick)
+            {
+                uint32_t codepoint = ((b1 & 0x1Fu) << 6) | (b2 & 0x3Fu);
+                if (codepoint < 0x7Fu) { return { validation_error::overlong_enocoding, i, codepoint_count }; }
+            }
 
             i += 2;
             codepoint_count++;
         }
         else if (b1 < 0xF0u) // 1110xxxx 10xxxxxx 10xxxxxx
         {
-            if (i + 2 >= range.size()) { return { validation_error::unexpected_end, range.to_utf8(i), codepoint_count }; }
+            if (i + 2 >= range.size()) { return { validation_error::unexpected_end, i, codepoint_count }; }
 
             const auto b2 = range[i + 1];
             const auto b3 = range[i + 2];
-            if ((b2 ^ 0x80u | b3 ^ 0x80u) & 0xC0u) { return { validation_error::unexpected_non_continuation_byte, range.to_utf8(i), codepoint_count }; }
+            if ((b2 ^ 0x80u | b3 ^ 0x80u) & 0xC0u) { return { validation_error::unexpected_non_continuation_byte, i, codepoint_count }; }
 
-            uint32_t codepoint = ((b1 & 0xFu) << 12) | ((b2 & 0x3Fu) << 6) | (b3 & 0x3Fu);
-            if (codepoint <= 0x7FFu) { return { validation_error::overlong_enocoding, range.to_utf8(i), codepoint_count }; }
+            if constexpr (!Quick)
+            {
+                uint32_t codepoint = ((b1 & 0xFu) << 12) | ((b2 & 0x3Fu) << 6) | (b3 & 0x3Fu);
+                if (codepoint <= 0x7FFu) { return { validation_error::overlong_enocoding, i, codepoint_count }; }
+            }
 
             i += 3;
             codepoint_count++;
         }
         else if (b1 < 0xF8u) // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
         {
-            if (i + 3 >= range.size()) { return { validation_error::unexpected_end, range.to_utf8(i), codepoint_count }; }
+            if (i + 3 >= range.size()) { return { validation_error::unexpected_end, i, codepoint_count }; }
 
             const auto b2 = range[i + 1];
             const auto b3 = range[i + 2];
             const auto b4 = range[i + 3];
-            if ((b2 ^ 0x80u | b3 ^ 0x80u | b4 ^ 0x80u) & 0xC0u) { return { validation_error::unexpected_non_continuation_byte, range.to_utf8(i), codepoint_count }; }
+            if ((b2 ^ 0x80u | b3 ^ 0x80u | b4 ^ 0x80u) & 0xC0u) { return { validation_error::unexpected_non_continuation_byte, i, codepoint_count }; }
 
-            uint32_t codepoint = ((b1 & 0x7u) << 18) | ((b2 & 0x3Fu) << 12) | ((b3 & 0x3Fu) << 6) | (b4 & 0x3Fu);
-            if (codepoint > 0x10FFFFu) { return { validation_error::invalid_codepoint, range.to_utf8(i), codepoint_count }; }
-            if (codepoint <= 0xFFFFu) { return { validation_error::overlong_enocoding, range.to_utf8(i), codepoint_count }; }
+            if constexpr (!Quick)
+            {
+                uint32_t codepoint = ((b1 & 0x7u) << 18) | ((b2 & 0x3Fu) << 12) | ((b3 & 0x3Fu) << 6) | (b4 & 0x3Fu);
+                if (codepoint > 0x10FFFFu) { return { validation_error::invalid_codepoint, i, codepoint_count }; }
+                if (codepoint <= 0xFFFFu) { return { validation_error::overlong_enocoding, i, codepoint_count }; }
+            }
 
             i += 4;
             codepoint_count++;
         }
         else // 11111xxx
         {
-            return { validation_error::invalid_byte, range.to_utf8(i), codepoint_count };
+            return { validation_error::invalid_byte, i, codepoint_count };
         }
     }
 
-    return { validation_error::success, range.to_utf8(i), codepoint_count };
+    return { validation_error::success, i, codepoint_count };
 }
 
-// do not check invalid_codepoint and overlong_enocoding
-validation_result validate_quick(byte_range range)
+// Counts the bytes that are not 10xxxxxx, a word at a time.
+LOSGODIS_INLINE size_t count_non_continuation(const char* data, size_t size)
 {
-    size_t codepoint_count = 0;
+    constexpr uint64_t low_bits = 0x0101010101010101u;
+
+    size_t count = 0;
     size_t i = 0;
-    while (i < range.size())
+    for (; size - i >= 8; i += 8)
     {
-        const auto b1 = range[i];
-        if (b1 < 0x80u) // 0xxxxxxx
+        const auto word = load_word(data + i);
+        const auto continuation = (word >> 7) & ~(word >> 6) & low_bits;
+        count += 8 - ((continuation * low_bits) >> 56);
+    }
+    for (; i < size; ++i)
+    {
+        count += (static_cast<uint8_t>(data[i]) & 0xC0u) != 0x80u;
+    }
+    return count;
+}
+
+// Moves count codepoints from offset, which has to be a codepoint start, to the
+// next codepoint start or the end. Blocks with fewer codepoint starts than the
+// ones left are skipped whole. count is left with what was not moved.
+LOSGODIS_INLINE size_t skip_codepoints(const char* data, size_t size, size_t offset, size_t& count)
+{
+    constexpr size_t skip_size = 64;
+
+    auto i = offset;
+    while (size - i >= skip_size)
+    {
+        const auto starts = count_non_continuation(data + i, skip_size);
+        if (starts > count) { break; }
+        count -= starts;
+        i += skip_size;
+    }
+    for (; i < size; ++i)
+    {
+        if ((static_cast<uint8_t>(data[i]) & 0xC0u) != 0x80u)
         {
-            i++;
-            codepoint_count++;
+            if (count == 0) { return i; }
+            count--;
         }
-        else if (b1 < 0xC0u) // 10xxxxxx continuation byte
+    }
+    return size;
+}
+
+// The last lead byte in the 3 bytes before offset, not before begin, or offset
+// if an ascii byte comes first or there is no lead. The codepoint of that lead
+// may straddle offset, but it can also be a complete 2 or 3 byte codepoint
+// that ends at offset, then it is just scanned again.
+LOSGODIS_INLINE size_t codepoint_start(byte_range range, size_t begin, size_t offset)
+{
+    for (size_t i = offset; i > begin && offset - i < 3; --i)
+    {
+        const auto b = range[i - 1];
+        if (b >= 0xC0u) { return i - 1; } // lead byte
+        if (b < 0x80u) { break; }
+    }
+    return offset;
+}
+
+// The simd kernel does the bulk of the work, the scalar validator takes over at
+// the end and at blocks the kernel flagged, to get the exact error position.
+template <bool Quick>
+scan_result scan_impl(byte_range range)
+{
+    static const auto validate_blocks = detail::select_block_validator();
+
+    scan_result result{ validation_error::success, 0, 0 };
+    if (validate_blocks != nullptr)
+    {
+        for (;;)
         {
-            return { validation_error::unexpected_continuation_byte, range.to_utf8(i), codepoint_count };
+            const auto block = validate_blocks(range.begin(), result.end, range.size(), result.codepoint_count);
+            const auto start = codepoint_start(range, result.end, block);
+            if (start != block) { result.codepoint_count--; }
+
+            const auto stop = std::min(block + detail::block_size, range.size());
+            result = validate_scalar<Quick>(range, start, result.codepoint_count, stop);
+            if (result.error != validation_error::success || result.end == range.size()) { break; }
         }
-        else if (b1 < 0xE0u) // 110xxxxx 10xxxxxx
+    }
+    else
+    {
+        result = validate_scalar<Quick>(range, 0, 0, range.size());
+    }
+
+    return result;
+}
+
+template <bool Quick>
+validation_result validate_impl(byte_range range)
+{
+    const auto result = scan_impl<Quick>(range);
+    return { result.error, range.to_utf8(result.end, result.codepoint_count), result.codepoint_count };
+}
+
+LOSGODIS_INLINE scan_result scan(byte_range range, bool quick)
+{
+    return quick ? scan_impl<true>(range) : scan_impl<false>(range);
+}
+
+// the byte count of a codepoint from its lead byte, which has to be valid
+LOSGODIS_INLINE size_t sequence_length(uint8_t lead)
+{
+    return lead < 0xE0u ? 2 : lead < 0xF0u ? 3 : 4;
+}
+
+// The first non continuation byte in the 4 bytes at offset, a codepoint
+// boundary if the bytes before it are valid. If all 4 are continuation bytes
+// the validator fails before getting past them, with or without the cut.
+LOSGODIS_INLINE size_t chunk_boundary(byte_range range, size_t offset)
+{
+    const auto end = std::min(offset + 4, range.size());
+    for (auto i = offset; i < end; ++i)
+    {
+        if ((range[i] & 0xC0u) != 0x80u) { return i; }
+    }
+    return end;
+}
+
+} // namespace detail
+
+LOSGODIS_INLINE validation_result validate(byte_range range)
+{
+    LOSGODIS_TRACE_VALIDATE_BEGIN(range.size());
+    const auto result = detail::validate_impl<false>(range);
+    LOSGODIS_TRACE_VALIDATE_END(range.size(), result.error);
+    return result;
+}
+
+// do not check invalid_codepoint and overlong_enocoding
+LOSGODIS_INLINE validation_result validate_quick(byte_range range)
+{
+    LOSGODIS_TRACE_VALIDATE_BEGIN(range.size());
+    const auto result = detail::validate_impl<true>(range);
+    LOSGODIS_TRACE_VALIDATE_END(range.size(), result.error);
+    return result;
+}
+
+LOSGODIS_INLINE size_t count_codepoints(utf8_range range)
+{
+    static const auto count_blocks = detail::select_block_counter();
+
+    if (range.known_codepoint_count() != utf8_range::unknown_count)
+    {
+        return range.known_codepoint_count();
+    }
+
+    size_t count = 0;
+    size_t i = 0;
+    if (count_blocks != nullptr)
+    {
+        i = count_blocks(range.data(), range.size(), count);
+    }
+    return count + detail::count_non_continuation(range.data() + i, range.size() - i);
+}
+
+LOSGODIS_INLINE codepoint_t utf8_range::at(size_t n) const
+{
+    auto count = n;
+    const auto offset = detail::skip_codepoints(start_, byte_count_, 0, count);
+    assert(offset < byte_count_);
+    return *iterator{ start_ + offset };
+}
+
+LOSGODIS_INLINE utf8_range utf8_range::substr(size_t pos, size_t count) const
+{
+    auto skipped = pos;
+    const auto begin = detail::skip_codepoints(start_, byte_count_, 0, skipped);
+    assert(skipped == 0);
+
+    auto left = count;
+    const auto end = detail::skip_codepoints(start_, byte_count_, begin, left);
+    return utf8_range{ start_ + begin, end - begin, count - left };
+}
+
+LOSGODIS_INLINE codepoint_index::codepoint_index(utf8_range range) :
+    range_{ range },
+    codepoint_count_{ 0 }
+{
+    size_t offset = 0;
+    for (;;)
+    {
+        offsets_.push_back(offset);
+        auto count = stride;
+        offset = detail::skip_codepoints(range.data(), range.size(), offset, count);
+        if (offset == range.size())
         {
-            if (i + 1 >= range.size()) { return { validation_error::unexpected_end, range.to_utf8(i), codepoint_count }; }
+            codepoint_count_ += stride - count;
+            break;
+        }
+        codepoint_count_ += stride;
+    }
+}
 
-            const auto b2 = range[i + 1];
-            if ((b2 ^ 0x80u) & 0xC0u) { return { validation_error::unexpected_non_continuation_byte, range.to_utf8(i), codepoint_count }; }
+LOSGODIS_INLINE size_t codepoint_index::offset(size_t n) const
+{
+    assert(n <= codepoint_count_);
+    if (n == codepoint_count_) { return range_.size(); }
 
-            i += 2;
-            codepoint_count++;
+    auto count = n % stride;
+    return detail::skip_codepoints(range_.data(), range_.size(), offsets_[n / stride], count);
+}
+
+LOSGODIS_INLINE codepoint_t codepoint_index::at(size_t n) const
+{
+    assert(n < codepoint_count_);
+    return *iterator{ range_.data() + offset(n) };
+}
+
+LOSGODIS_INLINE utf8_range codepoint_index::substr(size_t pos, size_t count) const
+{
+    assert(pos <= codepoint_count_);
+    count = std::min(count, codepoint_count_ - pos);
+    const auto begin = offset(pos);
+    const auto end = offset(pos + count);
+    return utf8_range{ range_.data() + begin, end - begin, count };
+}
+
+LOSGODIS_INLINE validation_result validate_parallel(byte_range range, const executor& execute, size_t chunk_size)
+{
+    chunk_size = std::max(chunk_size, size_t{ 64 });
+    if (range.size() <= chunk_size)
+    {
+        return validate(range);
+    }
+
+    std::vector<size_t> starts{ 0 };
+    for (auto start = chunk_size; start < range.size(); start = starts.back() + chunk_size)
+    {
+        const auto boundary = detail::chunk_boundary(range, start);
+        if (boundary == range.size()) { break; }
+        starts.push_back(boundary);
+    }
+    starts.push_back(range.size());
+
+    const auto chunk_count = starts.size() - 1;
+    std::vector<detail::scan_result> results(chunk_count, { validation_error::success, 0, 0 });
+    std::atomic<size_t> first_failed{ chunk_count };
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining = 0;
+
+    const auto run = [&](size_t chunk)
+    {
+        // nothing after a failed chunk matters
+        if (chunk < first_failed.load(std::memory_order_relaxed))
+        {
+            const byte_range part{ range.begin() + starts[chunk], starts[chunk + 1] - starts[chunk] };
+            results[chunk] = detail::scan_impl<false>(part);
+            if (results[chunk].error != validation_error::success)
+            {
+                auto failed = first_failed.load(std::memory_order_relaxed);
+                while (chunk < failed && !first_failed.compare_exchange_weak(failed, chunk, std::memory_order_relaxed)) {}
+            }
         }
-        else if (b1 < 0xF0u) // 1110xxxx 10xxxxxx 10xxxxxx
+        std::lock_guard<std::mutex> lock{ mutex };
+        if (--remaining == 0) { done.notify_one(); }
+    };
+
+    std::exception_ptr exception;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+    {
         {
-            if (i + 2 >= range.size()) { return { validation_error::unexpected_end, range.to_utf8(i), codepoint_count }; }
+            std::lock_guard<std::mutex> lock{ mutex };
+            remaining++;
+        }
+        try
+        {
+            execute([&run, chunk] { run(chunk); });
+        }
+        catch (...)
+        {
+            // the chunks already handed out still use the state on this stack
+            exception = std::current_exception();
+            std::lock_guard<std::mutex> lock{ mutex };
+            remaining--;
+            break;
+        }
+    }
 
-            const auto b2 = range[i + 1];
-            const auto b3 = range[i + 2];
-            if ((b2 ^ 0x80u | b3 ^ 0x80u) & 0xC0u) { return { validation_error::unexpected_non_continuation_byte, range.to_utf8(i), codepoint_count }; }
+    {
+        std::unique_lock<std::mutex> lock{ mutex };
+        done.wait(lock, [&] { return remaining == 0; });
+    }
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
 
-            i += 3;
-            codepoint_count++;
-        }
-        else if (b1 < 0xF8u) // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+    size_t codepoint_count = 0;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+    {
+        auto result = results[chunk];
+        codepoint_count += result.codepoint_count;
+        if (result.error != validation_error::success)
         {
-            if (i + 3 >= range.size()) { return { validation_error::unexpected_end, range.to_utf8(i), codepoint_count }; }
+            const auto end = starts[chunk] + result.end;
+            if (result.error == validation_error::unexpected_end && chunk + 1 < chunk_count)
+            {
+                // a cut codepoint is followed by the non continuation byte the next
+                // chunk starts at, unless it also runs past the end of the range
+                if (end + detail::sequence_length(range[end]) <= range.size())
+                {
+                    result.error = validation_error::unexpected_non_continuation_byte;
+                }
+                else
+                {
+                    result.error = detail::scan_impl<false>(byte_range{ range.begin() + end, range.size() - end }).error;
+                }
+            }
+            return { result.error, range.to_utf8(end, codepoint_count), codepoint_count };
+        }
+    }
+    return { validation_error::success, range.to_utf8(range.size(), codepoint_count), codepoint_count };
+}
 
-            const auto b2 = range[i + 1];
-            const auto b3 = range[i + 2];
-            const auto b4 = range[i + 3];
-            if ((b2 ^ 0x80u | b3 ^ 0x80u | b4 ^ 0x80u) & 0xC0u) { return { validation_error::unexpected_non_continuation_byte, range.to_utf8(i), codepoint_count }; }
+LOSGODIS_INLINE stream_result stream_validator::feed(byte_range chunk)
+{
+    if (error_ != validation_error::success) { return result(); }
 
-            i += 4;
-            codepoint_count++;
+    size_t i = 0;
+    if (pending_size_ != 0)
+    {
+        // finish the codepoint from the last chunk on its own, it is never more than 4 bytes
+        const auto needed = detail::sequence_length(static_cast<uint8_t>(pending_[0])) - pending_size_;
+        const auto taken = std::min(needed, chunk.size());
+        std::memcpy(pending_ + pending_size_, chunk.begin(), taken);
+
+        const auto scan = detail::scan(byte_range{ pending_, pending_size_ + taken }, quick_);
+        if (scan.error == validation_error::unexpected_end && taken < needed)
+        {
+            pending_size_ += taken;
+            return result();
         }
-        else // 11111xxx
+        if (scan.error != validation_error::success)
         {
-            return { validation_error::invalid_byte, range.to_utf8(i), codepoint_count };
+            error_ = scan.error;
+            return result();
         }
+
+        byte_count_ += pending_size_ + taken;
+        codepoint_count_++;
+        pending_size_ = 0;
+        i = taken;
     }
 
-    return { validation_error::success, range.to_utf8(i), codepoint_count };
+    const byte_range rest{ chunk.begin() + i, chunk.size() - i };
+    const auto scan = detail::scan(rest, quick_);
+    byte_count_ += scan.end;
+    codepoint_count_ += scan.codepoint_count;
+    if (scan.error == validation_error::unexpected_end)
+    {
+        // only the last few bytes can be cut off, keep them for the next chunk
+        pending_size_ = rest.size() - scan.end;
+        std::memcpy(pending_, rest.begin() + scan.end, pending_size_);
+    }
+    else
+    {
+        error_ = scan.error;
+    }
+    return result();
+}
+
+LOSGODIS_INLINE stream_result stream_validator::finish()
+{
+    if (error_ == validation_error::success && pending_size_ != 0)
+    {
+        error_ = validation_error::unexpected_end;
+        pending_size_ = 0;
+    }
+    return result();
+}
+
+LOSGODIS_INLINE void stream_validator::reset()
+{
+    error_ = validation_error::success;
+    byte_count_ = 0;
+    codepoint_count_ = 0;
+    pending_size_ = 0;
 }
 
 } // namespace losgodis::utf8
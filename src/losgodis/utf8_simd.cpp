@@ -0,0 +1,338 @@
+
+#include "utf8_simd.hpp"
+
+#include <cstdint>
+
+#if !defined(LOSGODIS_UTF8_NO_SIMD)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LOSGODIS_UTF8_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define LOSGODIS_UTF8_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+// Compile a region of functions for a specific instruction set, msvc does not
+// need it since it allows all intrinsics everywhere.
+#define LOSGODIS_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__)
+#define LOSGODIS_TARGET_REGION(isa) LOSGODIS_PRAGMA(clang attribute push(__attribute__((target(isa))), apply_to = function))
+#define LOSGODIS_UNTARGET_REGION _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define LOSGODIS_TARGET_REGION(isa) _Pragma("GCC push_options") LOSGODIS_PRAGMA(GCC target(isa))
+#define LOSGODIS_UNTARGET_REGION _Pragma("GCC pop_options")
+#else
+#define LOSGODIS_TARGET_REGION(isa)
+#define LOSGODIS_UNTARGET_REGION
+#endif
+
+namespace losgodis::utf8::detail
+{
+
+#if defined(LOSGODIS_UTF8_X86)
+
+// popcnt is there on every cpu with sse4.2
+#if defined(_MSC_VER) && !defined(__clang__)
+#define LOSGODIS_POPCOUNT32(x) _mm_popcnt_u32(x)
+#if defined(_M_X64)
+#define LOSGODIS_POPCOUNT64(x) _mm_popcnt_u64(x)
+#else
+#define LOSGODIS_POPCOUNT64(x) (_mm_popcnt_u32(static_cast<uint32_t>(x)) + _mm_popcnt_u32(static_cast<uint32_t>((x) >> 32)))
+#endif
+#else
+#define LOSGODIS_POPCOUNT32(x) __builtin_popcount(x)
+#define LOSGODIS_POPCOUNT64(x) __builtin_popcountll(x)
+#endif
+
+LOSGODIS_TARGET_REGION("sse4.2,popcnt")
+namespace sse42
+{
+
+struct simd
+{
+    using vec = __m128i;
+    static constexpr size_t width = 16;
+
+    static vec zero() { return _mm_setzero_si128(); }
+    static vec splat(uint8_t b) { return _mm_set1_epi8(static_cast<char>(b)); }
+    static vec load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+
+    static vec table(
+        uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint8_t b5, uint8_t b6, uint8_t b7,
+        uint8_t b8, uint8_t b9, uint8_t b10, uint8_t b11, uint8_t b12, uint8_t b13, uint8_t b14, uint8_t b15)
+    {
+        return _mm_setr_epi8(
+            static_cast<char>(b0), static_cast<char>(b1), static_cast<char>(b2), static_cast<char>(b3),
+            static_cast<char>(b4), static_cast<char>(b5), static_cast<char>(b6), static_cast<char>(b7),
+            static_cast<char>(b8), static_cast<char>(b9), static_cast<char>(b10), static_cast<char>(b11),
+            static_cast<char>(b12), static_cast<char>(b13), static_cast<char>(b14), static_cast<char>(b15));
+    }
+
+    static vec lookup(vec index, vec table) { return _mm_shuffle_epi8(table, index); }
+    static vec shr4(vec v) { return _mm_and_si128(_mm_srli_epi16(v, 4), splat(0x0F)); }
+    static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+    static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+    static vec xor_(vec a, vec b) { return _mm_xor_si128(a, b); }
+    static vec subs(vec a, uint8_t b) { return _mm_subs_epu8(a, splat(b)); }
+    static vec subs(vec a, vec b) { return _mm_subs_epu8(a, b); }
+
+    // input shifted N bytes, with the last N bytes of prev_input shifted in
+    template <int N>
+    static vec prev(vec input, vec prev_input) { return _mm_alignr_epi8(input, prev_input, 16 - N); }
+
+    static bool any(vec v) { return !_mm_testz_si128(v, v); }
+    static bool is_ascii(vec v) { return _mm_movemask_epi8(v) == 0; }
+
+    static size_t count_non_continuation(vec v)
+    {
+        const auto mask = _mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8(-65)));
+        return LOSGODIS_POPCOUNT32(static_cast<uint32_t>(mask));
+    }
+};
+
+#include "utf8_simd_kernel.inl"
+
+} // namespace sse42
+LOSGODIS_UNTARGET_REGION
+
+LOSGODIS_TARGET_REGION("avx2,popcnt")
+namespace avx2
+{
+
+struct simd
+{
+    using vec = __m256i;
+    static constexpr size_t width = 32;
+
+    static vec zero() { return _mm256_setzero_si256(); }
+    static vec splat(uint8_t b) { return _mm256_set1_epi8(static_cast<char>(b)); }
+    static vec load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+
+    static vec table(
+        uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint8_t b5, uint8_t b6, uint8_t b7,
+        uint8_t b8, uint8_t b9, uint8_t b10, uint8_t b11, uint8_t b12, uint8_t b13, uint8_t b14, uint8_t b15)
+    {
+        return _mm256_broadcastsi128_si256(_mm_setr_epi8(
+            static_cast<char>(b0), static_cast<char>(b1), static_cast<char>(b2), static_cast<char>(b3),
+            static_cast<char>(b4), static_cast<char>(b5), static_cast<char>(b6), static_cast<char>(b7),
+            static_cast<char>(b8), static_cast<char>(b9), static_cast<char>(b10), static_cast<char>(b11),
+            static_cast<char>(b12), static_cast<char>(b13), static_cast<char>(b14), static_cast<char>(b15)));
+    }
+
+    static vec lookup(vec index, vec table) { return _mm256_shuffle_epi8(table, index); }
+    static vec shr4(vec v) { return _mm256_and_si256(_mm256_srli_epi16(v, 4), splat(0x0F)); }
+    static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+    static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+    static vec xor_(vec a, vec b) { return _mm256_xor_si256(a, b); }
+    static vec subs(vec a, uint8_t b) { return _mm256_subs_epu8(a, splat(b)); }
+    static vec subs(vec a, vec b) { return _mm256_subs_epu8(a, b); }
+
+    // alignr works per 128 bit lane, so first line up the lane before each lane
+    template <int N>
+    static vec prev(vec input, vec prev_input)
+    {
+        return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 16 - N);
+    }
+
+    static bool any(vec v) { return !_mm256_testz_si256(v, v); }
+    static bool is_ascii(vec v) { return _mm256_movemask_epi8(v) == 0; }
+
+    static size_t count_non_continuation(vec v)
+    {
+        const auto mask = _mm256_movemask_epi8(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(-65)));
+        return LOSGODIS_POPCOUNT32(static_cast<uint32_t>(mask));
+    }
+};
+
+#include "utf8_simd_kernel.inl"
+
+} // namespace avx2
+LOSGODIS_UNTARGET_REGION
+
+LOSGODIS_TARGET_REGION("avx512f,avx512bw,popcnt")
+namespace avx512
+{
+
+struct simd
+{
+    using vec = __m512i;
+    static constexpr size_t width = 64;
+
+    static vec zero() { return _mm512_setzero_si512(); }
+    static vec splat(uint8_t b) { return _mm512_set1_epi8(static_cast<char>(b)); }
+    static vec load(const char* p) { return _mm512_loadu_si512(p); }
+
+    static vec table(
+        uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint8_t b5, uint8_t b6, uint8_t b7,
+        uint8_t b8, uint8_t b9, uint8_t b10, uint8_t b11, uint8_t b12, uint8_t b13, uint8_t b14, uint8_t b15)
+    {
+        return _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_setr_epi8(
+            static_cast<char>(b0), static_cast<char>(b1), static_cast<char>(b2), static_cast<char>(b3),
+            static_cast<char>(b4), static_cast<char>(b5), static_cast<char>(b6), static_cast<char>(b7),
+            static_cast<char>(b8), static_cast<char>(b9), static_cast<char>(b10), static_cast<char>(b11),
+            static_cast<char>(b12), static_cast<char>(b13), static_cast<char>(b14), static_cast<char>(b15)));
+    }
+
+    static vec lookup(vec index, vec table) { return _mm512_shuffle_epi8(table, index); }
+    static vec shr4(vec v) { return _mm512_and_si512(_mm512_srli_epi16(v, 4), splat(0x0F)); }
+    static vec and_(vec a, vec b) { return _mm512_and_si512(a, b); }
+    static vec or_(vec a, vec b) { return _mm512_or_si512(a, b); }
+    static vec xor_(vec a, vec b) { return _mm512_xor_si512(a, b); }
+    static vec subs(vec a, uint8_t b) { return _mm512_subs_epu8(a, splat(b)); }
+    static vec subs(vec a, vec b) { return _mm512_subs_epu8(a, b); }
+
+    // same as avx2 but with four lanes, the lane before lane 0 is the last lane of prev_input
+    template <int N>
+    static vec prev(vec input, vec prev_input)
+    {
+        const auto lanes = _mm512_permutex2var_epi64(prev_input, _mm512_set_epi64(13, 12, 11, 10, 9, 8, 7, 6), input);
+        return _mm512_alignr_epi8(input, lanes, 16 - N);
+    }
+
+    static bool any(vec v) { return _mm512_test_epi8_mask(v, v) != 0; }
+    static bool is_ascii(vec v) { return _mm512_movepi8_mask(v) == 0; }
+
+    static size_t count_non_continuation(vec v)
+    {
+        const auto mask = _mm512_cmpgt_epi8_mask(v, _mm512_set1_epi8(-65));
+        return LOSGODIS_POPCOUNT64(static_cast<uint64_t>(mask));
+    }
+};
+
+#include "utf8_simd_kernel.inl"
+
+} // namespace avx512
+LOSGODIS_UNTARGET_REGION
+
+struct cpu_features
+{
+    bool sse42 = false;
+    bool avx2 = false;
+    bool avx512 = false;
+};
+
+LOSGODIS_INLINE cpu_features detect_cpu_features()
+{
+    cpu_features features;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    if (max_leaf < 1) { return features; }
+
+    __cpuid(info, 1);
+    const bool popcnt = (info[2] & (1 << 23)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    features.sse42 = popcnt && (info[2] & (1 << 20)) != 0;
+    if (!osxsave || max_leaf < 7) { return features; }
+
+    // the os has to save the ymm and zmm registers
+    const auto xcr0 = _xgetbv(0);
+    const bool ymm = (xcr0 & 0x6) == 0x6;
+    const bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+    __cpuidex(info, 7, 0);
+    features.avx2 = ymm && features.sse42 && (info[1] & (1 << 5)) != 0;
+    features.avx512 = zmm && features.avx2 && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0;
+#else
+    // these check that the os supports the registers as well
+    __builtin_cpu_init();
+    features.sse42 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+    features.avx2 = features.sse42 && __builtin_cpu_supports("avx2");
+    features.avx512 = features.avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+    return features;
+}
+
+#elif defined(LOSGODIS_UTF8_NEON)
+
+namespace neon
+{
+
+struct simd
+{
+    using vec = uint8x16_t;
+    static constexpr size_t width = 16;
+
+    static vec zero() { return vdupq_n_u8(0); }
+    static vec splat(uint8_t b) { return vdupq_n_u8(b); }
+    static vec load(const char* p) { return vld1q_u8(reinterpret_cast<const uint8_t*>(p)); }
+
+    static vec table(
+        uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint8_t b5, uint8_t b6, uint8_t b7,
+        uint8_t b8, uint8_t b9, uint8_t b10, uint8_t b11, uint8_t b12, uint8_t b13, uint8_t b14, uint8_t b15)
+    {
+        const uint8_t bytes[16] = { b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, b12, b13, b14, b15 };
+        return vld1q_u8(bytes);
+    }
+
+    static vec lookup(vec index, vec table) { return vqtbl1q_u8(table, index); }
+    static vec shr4(vec v) { return vshrq_n_u8(v, 4); }
+    static vec and_(vec a, vec b) { return vandq_u8(a, b); }
+    static vec or_(vec a, vec b) { return vorrq_u8(a, b); }
+    static vec xor_(vec a, vec b) { return veorq_u8(a, b); }
+    static vec subs(vec a, uint8_t b) { return vqsubq_u8(a, splat(b)); }
+    static vec subs(vec a, vec b) { return vqsubq_u8(a, b); }
+
+    template <int N>
+    static vec prev(vec input, vec prev_input) { return vextq_u8(prev_input, input, 16 - N); }
+
+    static bool any(vec v) { return vmaxvq_u8(v) != 0; }
+    static bool is_ascii(vec v) { return vmaxvq_u8(v) < 0x80u; }
+
+    static size_t count_non_continuation(vec v)
+    {
+        const auto mask = vcgtq_s8(vreinterpretq_s8_u8(v), vdupq_n_s8(-65));
+        return vaddvq_u8(vandq_u8(mask, vdupq_n_u8(1)));
+    }
+};
+
+#include "utf8_simd_kernel.inl"
+
+} // namespace neon
+
+#endif
+
+LOSGODIS_INLINE block_validator select_block_validator()
+{
+#if defined(LOSGODIS_UTF8_X86)
+    const auto features = detect_cpu_features();
+    if (features.avx512) { return avx512::validate_blocks; }
+    if (features.avx2) { return avx2::validate_blocks; }
+    if (features.sse42) { return sse42::validate_blocks; }
+    return nullptr;
+#elif defined(LOSGODIS_UTF8_NEON)
+    return neon::validate_blocks;
+#else
+    return nullptr;
+#endif
+}
+
+LOSGODIS_INLINE block_counter select_block_counter()
+{
+#if defined(LOSGODIS_UTF8_X86)
+    const auto features = detect_cpu_features();
+    if (features.avx512) { return avx512::count_blocks; }
+    if (features.avx2) { return avx2::count_blocks; }
+    if (features.sse42) { return sse42::count_blocks; }
+    return nullptr;
+#elif defined(LOSGODIS_UTF8_NEON)
+    return neon::count_blocks;
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace losgodis::utf8::detail
+
+#undef LOSGODIS_UTF8_X86
+#undef LOSGODIS_UTF8_NEON
+#undef LOSGODIS_POPCOUNT32
+#undef LOSGODIS_POPCOUNT64
+#undef LOSGODIS_TARGET_REGION
+#undef LOSGODIS_UNTARGET_REGION
+#undef LOSGODIS_PRAGMA
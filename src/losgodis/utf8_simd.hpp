@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+
+    block_validator
+
+Internal interface to the simd validation kernels. A kernel validates whole
+blocks of block_size bytes, starting at a codepoint boundary, and stops at the
+first block that might contain an error or when there is less than a block
+left. The kernels are conservative, they may flag a valid block, so the
+scalar validator always has the final say on a flagged block.
+
+
+    block_counter
+
+Counts codepoints in whole blocks without validating them.
+
+*/
+
+#include "losgodis/config.hpp"
+
+#include <cstddef>
+
+namespace losgodis::utf8::detail
+{
+
+constexpr size_t block_size = 64;
+
+// Returns the offset of the first block that was not validated, codepoint_count
+// is increased by the number of codepoints in the validated blocks. Note that
+// a codepoint may straddle the returned offset.
+using block_validator = size_t (*)(const char* data, size_t begin, size_t size, size_t& codepoint_count);
+
+// Picks the best kernel for the cpu, nullptr if there is none.
+block_validator select_block_validator();
+
+// Adds the number of non continuation bytes in the whole blocks of data to
+// codepoint_count, returns the offset after the last block.
+using block_counter = size_t (*)(const char* data, size_t size, size_t& codepoint_count);
+
+block_counter select_block_counter();
+
+} // namespace losgodis::utf8::detail
@@ -0,0 +1,175 @@
+
+// Generic part of the simd validation kernels, included once per instruction
+// set from utf8_simd.cpp. Expects a struct simd to be declared in the
+// enclosing namespace, with the vector type and operations of that instruction
+// set.
+//
+// The algorithm is the lookup table validation by John Keiser and Daniel
+// Lemire, https://arxiv.org/abs/2010.03090. Every byte is classified by three
+// 16 entry tables, indexed by the high and low nibble of the previous byte and
+// the high nibble of the current byte. The error bits of the three lookups are
+// and:ed together, anything left is an error. Surrogates are not flagged since
+// the scalar validator accepts them.
+
+using vec = simd::vec;
+
+inline constexpr size_t vectors_per_block = block_size / simd::width;
+
+inline constexpr uint8_t too_short = 1 << 0; // 11______ 0_______, 11______ 11______
+inline constexpr uint8_t too_long = 1 << 1; // 0_______ 10______
+inline constexpr uint8_t overlong_3 = 1 << 2; // 11100000 100_____
+inline constexpr uint8_t too_large = 1 << 3; // 11110100 1001____, 11110100 101_____, 11110101+ 1001____, 11110101+ 101_____
+inline constexpr uint8_t overlong_2 = 1 << 5; // 1100000_ 10______
+inline constexpr uint8_t too_large_1000 = 1 << 6; // 11110101+ 1000____
+inline constexpr uint8_t overlong_4 = 1 << 6; // 11110000 1000____
+inline constexpr uint8_t two_conts = 1 << 7; // 10______ 10______
+inline constexpr uint8_t carry = too_short | too_long | two_conts;
+
+inline vec check_special_cases(vec input, vec prev1)
+{
+    const vec byte_1_high = simd::lookup(simd::shr4(prev1), simd::table(
+        // 0_______ ________ ascii
+        too_long, too_long, too_long, too_long,
+        too_long, too_long, too_long, too_long,
+        // 10______ ________ continuation
+        two_conts, two_conts, two_conts, two_conts,
+        // 1100____ ________ two byte lead
+        too_short | overlong_2,
+        // 1101____ ________ two byte lead
+        too_short,
+        // 1110____ ________ three byte lead
+        too_short | overlong_3,
+        // 1111____ ________ four+ byte lead
+        too_short | too_large | too_large_1000 | overlong_4));
+
+    const vec byte_1_low = simd::lookup(simd::and_(prev1, simd::splat(0x0F)), simd::table(
+        // ____0000 ________
+        carry | overlong_3 | overlong_2 | overlong_4,
+        // ____0001 ________
+        carry | overlong_2,
+        // ____001_ ________
+        carry,
+        carry,
+        // ____0100 ________
+        carry | too_large,
+        // ____0101 ________
+        carry | too_large | too_large_1000,
+        // ____011_ ________
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        // ____1___ ________
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000));
+
+    const vec byte_2_high = simd::lookup(simd::shr4(input), simd::table(
+        // ________ 0_______ ascii
+        too_short, too_short, too_short, too_short,
+        too_short, too_short, too_short, too_short,
+        // ________ 1000____
+        too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+        // ________ 1001____
+        too_long | overlong_2 | two_conts | overlong_3 | too_large,
+        // ________ 101_____
+        too_long | overlong_2 | two_conts | too_large,
+        too_long | overlong_2 | two_conts | too_large,
+        // ________ 11______
+        too_short, too_short, too_short, too_short));
+
+    return simd::and_(simd::and_(byte_1_high, byte_1_low), byte_2_high);
+}
+
+// Bytes two and three of three and four byte sequences have to be continuations,
+// and they are the ones flagged as two_conts by check_special_cases.
+inline vec check_multibyte_lengths(vec input, vec prev_input, vec special_cases)
+{
+    const vec prev2 = simd::prev<2>(input, prev_input);
+    const vec prev3 = simd::prev<3>(input, prev_input);
+    const vec must_be_2_3_continuation = simd::or_(
+        simd::subs(prev2, 0xE0u - 0x80u),
+        simd::subs(prev3, 0xF0u - 0x80u));
+    return simd::xor_(simd::and_(must_be_2_3_continuation, simd::splat(0x80)), special_cases);
+}
+
+inline vec check_bytes(vec input, vec prev_input)
+{
+    const vec prev1 = simd::prev<1>(input, prev_input);
+    return check_multibyte_lengths(input, prev_input, check_special_cases(input, prev1));
+}
+
+// Non zero if the last bytes of input is the start of a codepoint that has not ended.
+inline vec is_incomplete(vec input)
+{
+    alignas(64) static const uint8_t max_value[64] = {
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        0xF0u - 1, 0xE0u - 1, 0xC0u - 1 };
+    return simd::subs(input, simd::load(reinterpret_cast<const char*>(max_value) + 64 - simd::width));
+}
+
+LOSGODIS_INLINE size_t validate_blocks(const char* data, size_t begin, size_t size, size_t& codepoint_count)
+{
+    vec prev_input = simd::zero();
+    vec prev_incomplete = simd::zero();
+
+    size_t i = begin;
+    for (; size - i >= block_size; i += block_size)
+    {
+        vec input[vectors_per_block];
+        vec any_bits = simd::zero();
+        for (size_t v = 0; v < vectors_per_block; ++v)
+        {
+            input[v] = simd::load(data + i + v * simd::width);
+            any_bits = simd::or_(any_bits, input[v]);
+        }
+
+        vec error;
+        size_t block_count;
+        if (simd::is_ascii(any_bits))
+        {
+            error = prev_incomplete;
+            prev_incomplete = simd::zero();
+            block_count = block_size;
+        }
+        else
+        {
+            error = check_bytes(input[0], prev_input);
+            block_count = simd::count_non_continuation(input[0]);
+            for (size_t v = 1; v < vectors_per_block; ++v)
+            {
+                error = simd::or_(error, check_bytes(input[v], input[v - 1]));
+                block_count += simd::count_non_continuation(input[v]);
+            }
+            prev_incomplete = is_incomplete(input[vectors_per_block - 1]);
+        }
+
+        if (simd::any(error))
+        {
+            break;
+        }
+
+        prev_input = input[vectors_per_block - 1];
+        codepoint_count += block_count;
+    }
+    return i;
+}
+
+LOSGODIS_INLINE size_t count_blocks(const char* data, size_t size, size_t& codepoint_count)
+{
+    size_t i = 0;
+    for (; size - i >= block_size; i += block_size)
+    {
+        for (size_t v = 0; v < vectors_per_block; ++v)
+        {
+            codepoint_count += simd::count_non_continuation(simd::load(data + i + v * simd::width));
+        }
+    }
+    return i;
+}
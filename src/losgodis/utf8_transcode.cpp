@@ -0,0 +1,250 @@
+
+#include "losgodis/utf8_transcode.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace losgodis::utf8
+{
+
+namespace detail
+{
+
+inline constexpr codepoint_t replacement_character = 0xFFFDu;
+
+// the size of the chunks validate_to_ validates before decoding them
+inline constexpr size_t transcode_chunk_size = 16 * 1024;
+
+LOSGODIS_INLINE bool is_ascii_word(const char* data)
+{
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return (word & 0x8080808080808080u) == 0;
+}
+
+template <class Unit>
+size_t decode(const char* data, size_t size, Unit* out)
+{
+    const auto start = out;
+    const auto byte = [data](size_t i) { return static_cast<codepoint_t>(static_cast<uint8_t>(data[i])); };
+
+    size_t i = 0;
+    while (i < size)
+    {
+        if (byte(i) < 0x80u) // 0xxxxxxx
+        {
+            while (size - i >= 8 && is_ascii_word(data + i))
+            {
+                for (size_t k = 0; k < 8; ++k)
+                {
+                    out[k] = static_cast<Unit>(byte(i + k));
+                }
+                i += 8;
+                out += 8;
+            }
+            while (i < size && byte(i) < 0x80u)
+            {
+                *out++ = static_cast<Unit>(byte(i++));
+            }
+            continue;
+        }
+
+        const auto b1 = byte(i);
+        if (b1 < 0xE0u) // 110xxxxx 10xxxxxx
+        {
+            *out++ = static_cast<Unit>(((b1 & 0x1Fu) << 6) | (byte(i + 1) & 0x3Fu));
+            i += 2;
+        }
+        else if (b1 < 0xF0u) // 1110xxxx 10xxxxxx 10xxxxxx
+        {
+            *out++ = static_cast<Unit>(((b1 & 0xFu) << 12) | ((byte(i + 1) & 0x3Fu) << 6) | (byte(i + 2) & 0x3Fu));
+            i += 3;
+        }
+        else // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+        {
+            const auto codepoint = ((b1 & 0x7u) << 18) | ((byte(i + 1) & 0x3Fu) << 12) | ((byte(i + 2) & 0x3Fu) << 6) | (byte(i + 3) & 0x3Fu);
+            if constexpr (std::is_same_v<Unit, char16_t>)
+            {
+                *out++ = static_cast<char16_t>(0xD800u + ((codepoint - 0x10000u) >> 10));
+                *out++ = static_cast<char16_t>(0xDC00u + (codepoint & 0x3FFu));
+            }
+            else
+            {
+                *out++ = codepoint;
+            }
+            i += 4;
+        }
+    }
+    return static_cast<size_t>(out - start);
+}
+
+template <class Unit>
+transcode_result validate_and_decode(byte_range range, Unit* out)
+{
+    stream_validator validator;
+    size_t written = 0;
+    size_t decoded = 0;
+    for (size_t i = 0; i < range.size(); i += transcode_chunk_size)
+    {
+        const auto result = validator.feed({ range.begin() + i, std::min(transcode_chunk_size, range.size() - i) });
+        written += decode(range.begin() + decoded, result.byte_count - decoded, out + written);
+        decoded = result.byte_count;
+        if (result.error != validation_error::success)
+        {
+            return { result.error, decoded, written };
+        }
+    }
+    const auto result = validator.finish();
+    return { result.error, result.byte_count, written };
+}
+
+LOSGODIS_INLINE size_t utf8_size(codepoint_t codepoint)
+{
+    return codepoint < 0x80u ? 1 : codepoint < 0x800u ? 2 : codepoint < 0x10000u ? 3 : 4;
+}
+
+LOSGODIS_INLINE char* put_utf8(char* out, codepoint_t codepoint)
+{
+    if (codepoint < 0x80u)
+    {
+        *out++ = static_cast<char>(codepoint);
+    }
+    else if (codepoint < 0x800u)
+    {
+        *out++ = static_cast<char>(0xC0u | (codepoint >> 6));
+        *out++ = static_cast<char>(0x80u | (codepoint & 0x3Fu));
+    }
+    else if (codepoint < 0x10000u)
+    {
+        *out++ = static_cast<char>(0xE0u | (codepoint >> 12));
+        *out++ = static_cast<char>(0x80u | ((codepoint >> 6) & 0x3Fu));
+        *out++ = static_cast<char>(0x80u | (codepoint & 0x3Fu));
+    }
+    else
+    {
+        *out++ = static_cast<char>(0xF0u | (codepoint >> 18));
+        *out++ = static_cast<char>(0x80u | ((codepoint >> 12) & 0x3Fu));
+        *out++ = static_cast<char>(0x80u | ((codepoint >> 6) & 0x3Fu));
+        *out++ = static_cast<char>(0x80u | (codepoint & 0x3Fu));
+    }
+    return out;
+}
+
+LOSGODIS_INLINE bool is_surrogate(codepoint_t codepoint) { return (codepoint & 0xFFFFF800u) == 0xD800u; }
+LOSGODIS_INLINE bool is_high_surrogate(codepoint_t unit) { return (unit & 0xFC00u) == 0xD800u; }
+LOSGODIS_INLINE bool is_low_surrogate(codepoint_t unit) { return (unit & 0xFC00u) == 0xDC00u; }
+
+// The codepoint at in[i], i is moved past it. Unpaired surrogates are replaced.
+template <class Unit>
+codepoint_t next_codepoint(const Unit* in, size_t count, size_t& i)
+{
+    const codepoint_t unit = in[i++];
+    if constexpr (std::is_same_v<Unit, char16_t>)
+    {
+        if (is_high_surrogate(unit) && i < count && is_low_surrogate(in[i]))
+        {
+            return 0x10000u + ((unit - 0xD800u) << 10) + (in[i++] - 0xDC00u);
+        }
+    }
+    return unit > 0x10FFFFu || is_surrogate(unit) ? replacement_character : unit;
+}
+
+// ascii is narrowed 8 units at a time, the compiler vectorizes both loops
+template <class Unit>
+size_t encode(const Unit* in, size_t count, char* out)
+{
+    const auto start = out;
+    size_t i = 0;
+    while (i < count)
+    {
+        while (count - i >= 8)
+        {
+            codepoint_t any_bits = 0;
+            for (size_t k = 0; k < 8; ++k)
+            {
+                any_bits |= in[i + k];
+            }
+            if (any_bits >= 0x80u) { break; }
+
+            for (size_t k = 0; k < 8; ++k)
+            {
+                out[k] = static_cast<char>(in[i + k]);
+            }
+            i += 8;
+            out += 8;
+        }
+        if (i < count)
+        {
+            out = put_utf8(out, next_codepoint(in, count, i));
+        }
+    }
+    return static_cast<size_t>(out - start);
+}
+
+template <class Unit>
+size_t encoded_length(const Unit* in, size_t count)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < count;)
+    {
+        length += utf8_size(next_codepoint(in, count, i));
+    }
+    return length;
+}
+
+} // namespace detail
+
+LOSGODIS_INLINE size_t decode_to_utf32(utf8_range range, codepoint_t* out)
+{
+    return detail::decode(range.data(), range.size(), out);
+}
+
+LOSGODIS_INLINE size_t decode_to_utf16(utf8_range range, char16_t* out)
+{
+    return detail::decode(range.data(), range.size(), out);
+}
+
+// every four byte codepoint is a surrogate pair
+LOSGODIS_INLINE size_t utf16_length(utf8_range range)
+{
+    size_t pairs = 0;
+    for (size_t i = 0; i < range.size(); ++i)
+    {
+        pairs += static_cast<uint8_t>(range.data()[i]) >= 0xF0u;
+    }
+    return count_codepoints(range) + pairs;
+}
+
+LOSGODIS_INLINE transcode_result validate_to_utf32(byte_range range, codepoint_t* out)
+{
+    return detail::validate_and_decode(range, out);
+}
+
+LOSGODIS_INLINE transcode_result validate_to_utf16(byte_range range, char16_t* out)
+{
+    return detail::validate_and_decode(range, out);
+}
+
+LOSGODIS_INLINE size_t encode_utf8(const codepoint_t* in, size_t count, char* out)
+{
+    return detail::encode(in, count, out);
+}
+
+LOSGODIS_INLINE size_t encode_utf8(const char16_t* in, size_t count, char* out)
+{
+    return detail::encode(in, count, out);
+}
+
+LOSGODIS_INLINE size_t utf8_length(const codepoint_t* in, size_t count)
+{
+    return detail::encoded_length(in, count);
+}
+
+LOSGODIS_INLINE size_t utf8_length(const char16_t* in, size_t count)
+{
+    return detail::encoded_length(in, count);
+}
+
+} // namespace losgodis::utf8
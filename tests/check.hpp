@@ -0,0 +1,40 @@
+#pragma once
+
+// Checks for the tests, without a test framework. A failed CHECK prints the
+// expression and its line and the test goes on, main returns
+// test::exit_code() so ctest sees the failure.
+
+#include <cstdio>
+
+namespace losgodis::test
+{
+
+inline int failure_count = 0;
+
+inline bool check(bool ok, const char* expression, const char* file, int line)
+{
+    if (!ok)
+    {
+        // the first ones are enough to see what went wrong
+        if (failure_count < 20)
+        {
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+        }
+        failure_count++;
+    }
+    return ok;
+}
+
+inline int exit_code()
+{
+    if (failure_count != 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failure_count);
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace losgodis::test
+
+#define CHECK(expression) ::losgodis::test::check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,135 @@
+
+#include "check.hpp"
+
+#include "losgodis/concurrent_string_pool.hpp"
+#include "losgodis/thread_cache.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace losgodis;
+
+namespace
+{
+
+constexpr int thread_count = 4;
+
+std::vector<std::string> make_keys(size_t count)
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < count; ++i)
+    {
+        // short and long ones
+        keys.push_back(std::string(i % 3 * 20, 'k') + std::to_string(i * 7919));
+    }
+    return keys;
+}
+
+// threads add the same strings in different orders, all of them have to get
+// the same pooled data for each string
+void same_strings_from_all_threads()
+{
+    const auto keys = make_keys(20000);
+    concurrent_string_pool pool;
+    std::vector<std::vector<const char*>> results(thread_count, std::vector<const char*>(keys.size()));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                const auto k = (i * 31 + static_cast<size_t>(t) * 5003) % keys.size();
+                results[t][k] = pool.get_string(keys[k]).data();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (size_t k = 0; k < keys.size(); ++k)
+    {
+        CHECK(results[0][k] == keys[k]);
+        for (int t = 1; t < thread_count; ++t)
+        {
+            CHECK(results[t][k] == results[0][k]);
+        }
+        CHECK(pool.get_string(keys[k]).data() == results[0][k]);
+    }
+}
+
+// one thread_cache shared by the threads and short lived ones per thread, the
+// cache has to return what the pool returns
+void thread_caches()
+{
+    const auto keys = make_keys(1000);
+    concurrent_string_pool pool;
+    std::vector<fixed_string> expected;
+    for (const auto& key : keys)
+    {
+        expected.push_back(pool.get_string(key));
+    }
+
+    std::atomic<int> wrong{ 0 };
+    thread_cache<concurrent_string_pool> shared{ pool };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            for (size_t i = 0; i < 200000; ++i)
+            {
+                const auto k = (i * 31 + static_cast<size_t>(t)) % keys.size();
+                if (shared.get_string(keys[k]) != expected[k])
+                {
+                    wrong++;
+                }
+                if (i % 10000 == 0)
+                {
+                    thread_cache<concurrent_string_pool> local{ pool };
+                    if (local.get_string(keys[k]) != expected[k] || local.get_string(keys[k]) != expected[k])
+                    {
+                        wrong++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(wrong == 0);
+}
+
+// a new pool, maybe at the address of a destroyed one, does not see the
+// entries of the cache of the old one
+void destroyed_pools()
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        auto pool = std::make_unique<concurrent_string_pool>();
+        thread_cache<concurrent_string_pool> cache{ *pool };
+        const auto s = "string " + std::to_string(i % 3);
+        const auto str = cache.get_string(s);
+        CHECK(str.view() == s);
+        CHECK(cache.get_string(s) == str);
+        CHECK(pool->get_string(s) == str);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    same_strings_from_all_threads();
+    thread_caches();
+    destroyed_pools();
+    return test::exit_code();
+}
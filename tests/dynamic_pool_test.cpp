@@ -0,0 +1,138 @@
+
+#include "check.hpp"
+
+#include "losgodis/dynamic_pool.hpp"
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace losgodis;
+
+namespace
+{
+
+std::string make_string(std::mt19937& rng)
+{
+    return std::string(rng() % 40, 'x') + std::to_string(rng() % 5000);
+}
+
+// strings added in the middle of a compaction are not copied twice
+void add_while_compacting()
+{
+    dynamic_pool pool;
+    for (int i = 0; i < 1000; ++i)
+    {
+        pool.get_string("first " + std::to_string(i));
+    }
+    CHECK(!pool.compact_step(1));
+    for (int i = 0; i < 1000; ++i)
+    {
+        pool.get_string("second " + std::to_string(i));
+    }
+    pool.compact();
+    CHECK(pool.dead_bytes() == 0);
+    CHECK(pool.size() == 2000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        CHECK(pool.find(string_key{ "first " + std::to_string(i) }).view() == "first " + std::to_string(i));
+        CHECK(pool.find(string_key{ "second " + std::to_string(i) }).view() == "second " + std::to_string(i));
+    }
+}
+
+// free entries reused in the middle of a compaction, before and after the
+// entry it is at
+void reuse_while_compacting()
+{
+    dynamic_pool pool;
+    std::vector<pooled_string> strings;
+    for (int i = 0; i < 1000; ++i)
+    {
+        strings.push_back(pool.get_string("string " + std::to_string(i)));
+    }
+    for (int i = 0; i < 1000; i += 10)
+    {
+        pool.remove_string(strings[i]);
+    }
+    pool.compact();
+    CHECK(pool.dead_bytes() == 0);
+
+    CHECK(!pool.compact_step(500));
+    for (int i = 0; i < 100; ++i)
+    {
+        pool.get_string("reused " + std::to_string(i));
+    }
+    pool.compact();
+    CHECK(pool.dead_bytes() == 0);
+    CHECK(pool.size() == 1000);
+}
+
+// random adds, removes and compaction steps, compared to a map from the
+// strings to their handles
+void random_operations()
+{
+    std::mt19937 rng{ 1 };
+    dynamic_pool pool;
+    std::unordered_map<std::string, pooled_string> expected;
+    std::vector<pooled_string> removed;
+
+    for (int i = 0; i < 200000; ++i)
+    {
+        const auto op = rng() % 100;
+        const auto s = make_string(rng);
+        if (op < 60)
+        {
+            const auto str = pool.get_string(s);
+            CHECK(str.view() == s);
+            CHECK(expected.emplace(s, str).first->second == str);
+        }
+        else if (op < 90)
+        {
+            const auto it = expected.find(s);
+            CHECK(pool.remove_string(string_key{ s }) == (it != expected.end()));
+            if (it != expected.end())
+            {
+                removed.push_back(it->second);
+                expected.erase(it);
+            }
+        }
+        else if (op < 99)
+        {
+            pool.compact_step(rng() % 100);
+        }
+        else
+        {
+            pool.compact();
+            CHECK(pool.dead_bytes() == 0);
+        }
+    }
+
+    CHECK(pool.size() == expected.size());
+    for (const auto& [s, str] : expected)
+    {
+        CHECK(str.valid());
+        CHECK(str.view() == s);
+        CHECK(pool.find(string_key{ s }) == str);
+    }
+    for (const auto str : removed)
+    {
+        CHECK(!str.valid());
+    }
+    pool.compact();
+    CHECK(pool.dead_bytes() == 0);
+    for (const auto& [s, str] : expected)
+    {
+        CHECK(str.view() == s);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    add_while_compacting();
+    reuse_while_compacting();
+    random_operations();
+    return test::exit_code();
+}
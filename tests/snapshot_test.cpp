@@ -0,0 +1,148 @@
+
+#include "check.hpp"
+
+#include "losgodis/mapped_file.hpp"
+#include "losgodis/string_pool.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace losgodis;
+
+namespace
+{
+
+std::vector<std::string> make_strings()
+{
+    std::vector<std::string> strings;
+    for (int i = 0; i < 2000; ++i)
+    {
+        strings.push_back(std::string(static_cast<size_t>(i % 40), 's') + std::to_string(i));
+    }
+    return strings;
+}
+
+std::string write_snapshot(const std::vector<std::string>& strings)
+{
+    string_pool pool;
+    for (const auto& s : strings)
+    {
+        pool.get_string(s);
+    }
+    std::ostringstream out;
+    pool.write_snapshot(out);
+    return out.str();
+}
+
+// 8 byte aligned like a mapping
+struct aligned_copy
+{
+    explicit aligned_copy(const std::string& bytes, size_t size) :
+        words(size / 8 + 1), size{ size }
+    {
+        std::memcpy(words.data(), bytes.data(), size);
+    }
+
+    string_pool_snapshot snapshot() const { return string_pool_snapshot{ words.data(), size }; }
+
+    std::vector<uint64_t> words;
+    size_t                size;
+};
+
+// the strings of a snapshot are used in place
+void mapped()
+{
+    const auto strings = make_strings();
+    const char* path = "losgodis_snapshot_test.bin";
+    {
+        std::ofstream file{ path, std::ios::binary };
+        const auto bytes = write_snapshot(strings);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    {
+        const mapped_file file{ path };
+        string_pool pool{ file.snapshot() };
+        CHECK(pool.stats().string_count == strings.size());
+        for (const auto& s : strings)
+        {
+            const auto str = pool.get_string(s);
+            CHECK(str.view() == s);
+            CHECK(str.data() >= static_cast<const char*>(file.data()));
+            CHECK(str.data() < static_cast<const char*>(file.data()) + file.size());
+        }
+        CHECK(pool.get_string(std::string{ "not in the snapshot" }).view() == "not in the snapshot");
+    }
+    std::remove(path);
+}
+
+// every truncated snapshot is rejected
+void truncated()
+{
+    const auto bytes = write_snapshot(make_strings());
+    for (size_t size = 0; size < bytes.size(); size += 1 + size / 64)
+    {
+        const aligned_copy copy{ bytes, size };
+        bool rejected = false;
+        try
+        {
+            string_pool pool{ copy.snapshot() };
+        }
+        catch (const std::invalid_argument&)
+        {
+            rejected = true;
+        }
+        CHECK(rejected);
+    }
+}
+
+// a corrupt snapshot is rejected, or if the change is not caught every lookup
+// stays in the snapshot, the sanitizers see the reads that do not
+void corrupt()
+{
+    const auto strings = make_strings();
+    const auto bytes = write_snapshot(strings);
+    std::mt19937 rng{ 1 };
+    for (int i = 0; i < 2000; ++i)
+    {
+        aligned_copy copy{ bytes, bytes.size() };
+        auto data = reinterpret_cast<unsigned char*>(copy.words.data());
+        // mostly the header and the index, where the offsets are
+        const auto index_size = std::min<size_t>(bytes.size(), 64 + 4096 * 200);
+        for (auto n = 1 + rng() % 4; n > 0; --n)
+        {
+            data[rng() % (rng() % 4 == 0 ? bytes.size() : index_size)] ^= static_cast<unsigned char>(1u << rng() % 8);
+        }
+
+        try
+        {
+            string_pool pool{ copy.snapshot() };
+            const auto begin = reinterpret_cast<const char*>(data);
+            for (const auto& s : strings)
+            {
+                const auto str = pool.get_string(s);
+                CHECK(str.view() == s);
+                const auto in_snapshot = str.data() >= begin && str.data() < begin + bytes.size();
+                CHECK(!in_snapshot || str.data() + str.size() < begin + bytes.size());
+            }
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    mapped();
+    truncated();
+    corrupt();
+    return test::exit_code();
+}
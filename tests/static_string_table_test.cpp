@@ -0,0 +1,78 @@
+
+#include "check.hpp"
+
+#include "losgodis/static_string_table.hpp"
+
+#include <string>
+
+using namespace losgodis;
+
+namespace
+{
+
+constexpr auto keywords = make_static_string_table({
+    "if"_key, "else"_key, "for"_key, "while"_key, "do"_key, "return"_key, "break"_key, "continue"_key,
+    "switch"_key, "case"_key, "default"_key, "goto"_key, "const"_key, "static"_key, "class"_key, "struct"_key });
+
+static_assert(keywords.size() == 16);
+static_assert(keywords.index_of("while"_key) == 3);
+static_assert(keywords.contains("struct"_key));
+static_assert(!keywords.contains("whilst"_key));
+static_assert(keywords.index_of(""_key) == keywords.npos);
+
+// index_of can be a case label
+int loop_kind(string_key key)
+{
+    switch (keywords.index_of(key))
+    {
+    case keywords.index_of("for"_key): return 1;
+    case keywords.index_of("while"_key): return 2;
+    case keywords.index_of("do"_key): return 3;
+    default: return 0;
+    }
+}
+
+void lookups()
+{
+    for (size_t i = 0; i < keywords.size(); ++i)
+    {
+        const auto str = keywords[i];
+        CHECK(keywords.index_of(string_key{ str.view() }) == i);
+        CHECK(keywords.find(string_key{ str.view() })->data() == str.data());
+    }
+    CHECK(loop_kind(string_key{ std::string{ "while" } }) == 2);
+    CHECK(loop_kind(string_key{ std::string{ "do" } }) == 3);
+    CHECK(loop_kind(string_key{ std::string{ "if" } }) == 0);
+    CHECK(loop_kind(string_key{ std::string{ "wh" } }) == 0);
+    CHECK(!keywords.contains(string_key{ std::string{ "iff" } }));
+}
+
+// 1000 strings, built at run time
+#define LOSGODIS_KEY(n) "key_" #n ""_key
+#define LOSGODIS_KEYS_10(n) LOSGODIS_KEY(n##0), LOSGODIS_KEY(n##1), LOSGODIS_KEY(n##2), LOSGODIS_KEY(n##3), LOSGODIS_KEY(n##4), \
+    LOSGODIS_KEY(n##5), LOSGODIS_KEY(n##6), LOSGODIS_KEY(n##7), LOSGODIS_KEY(n##8), LOSGODIS_KEY(n##9)
+#define LOSGODIS_KEYS_100(n) LOSGODIS_KEYS_10(n##0), LOSGODIS_KEYS_10(n##1), LOSGODIS_KEYS_10(n##2), LOSGODIS_KEYS_10(n##3), LOSGODIS_KEYS_10(n##4), \
+    LOSGODIS_KEYS_10(n##5), LOSGODIS_KEYS_10(n##6), LOSGODIS_KEYS_10(n##7), LOSGODIS_KEYS_10(n##8), LOSGODIS_KEYS_10(n##9)
+
+void big_table()
+{
+    const auto table = make_static_string_table({
+        LOSGODIS_KEYS_100(1), LOSGODIS_KEYS_100(2), LOSGODIS_KEYS_100(3), LOSGODIS_KEYS_100(4), LOSGODIS_KEYS_100(5),
+        LOSGODIS_KEYS_100(6), LOSGODIS_KEYS_100(7), LOSGODIS_KEYS_100(8), LOSGODIS_KEYS_100(9), LOSGODIS_KEYS_100(a) });
+    CHECK(table.size() == 1000);
+    for (size_t i = 0; i < table.size(); ++i)
+    {
+        CHECK(table.index_of(string_key{ table[i].view() }) == i);
+    }
+    CHECK(table.index_of(string_key{ std::string{ "key_100" } }) == 0);
+    CHECK(!table.contains(string_key{ std::string{ "key_1000" } }));
+}
+
+} // namespace
+
+int main()
+{
+    lookups();
+    big_table();
+    return test::exit_code();
+}
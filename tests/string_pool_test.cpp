@@ -0,0 +1,907 @@
+
+#include "check.hpp"
+
+#include "losgodis/string_pool.hpp"
+#include "losgodis/thread_cache.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace losgodis;
+
+namespace
+{
+
+// random lowercase strings, short ones are kept in the index slots, long ones
+// only in the pages
+std::vector<std::string> make_strings(size_t count, size_t max_size, uint32_t seed)
+{
+    std::mt19937 rng{ seed };
+    std::vector<std::string> strings(count);
+    for (auto& s : strings)
+    {
+        s.resize(rng() % (max_size + 1));
+        for (auto& c : s)
+        {
+            c = static_cast<char>('a' + rng() % 26);
+        }
+    }
+    return strings;
+}
+
+// every string has one fixed_string, the same as a map from the string to its
+// first fixed_string
+void get_string()
+{
+    string_pool pool;
+    std::unordered_map<std::string, fixed_string> expected;
+    for (const auto& s : make_strings(100000, 40, 1))
+    {
+        const auto str = pool.get_string(s);
+        CHECK(str.view() == s);
+        CHECK(str.c_str()[s.size()] == '\0');
+        const auto [it, added] = expected.emplace(s, str);
+        CHECK(it->second == str);
+    }
+    for (const auto& [s, str] : expected)
+    {
+        CHECK(pool.get_string(s) == str);
+        CHECK(pool.get_string(std::string_view{ s }) == str);
+    }
+    CHECK(pool.stats().string_count == expected.size());
+
+    // a literal keeps its own memory
+    const auto literal = "a literal that is not in the pool yet"_key;
+    const auto str = pool.get_string(literal);
+    CHECK(str.data() == literal.key_.view().data());
+    CHECK(pool.get_string(std::string{ literal.key_.view() }) == str);
+}
+
+// get_strings returns what get_string would, for keys that are in the pool,
+// new and in the batch more than once
+void get_strings()
+{
+    string_pool pool;
+    const auto strings = make_strings(20000, 30, 5);
+    for (size_t i = 0; i < strings.size(); i += 3)
+    {
+        pool.get_string(strings[i]);
+    }
+
+    std::vector<string_key> keys;
+    for (const auto& s : strings)
+    {
+        keys.emplace_back(s);
+    }
+    // duplicates, next to each other too
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        keys.push_back(keys[i * 7 % keys.size()]);
+        keys.push_back(keys[keys.size() - 1]);
+    }
+
+    std::vector<fixed_string> out{ pool.get_string(std::string{ "before" }) };
+    pool.get_strings(keys.data(), keys.size(), out);
+    CHECK(out.size() == keys.size() + 1);
+    CHECK(out[0].view() == "before");
+
+    std::unordered_map<std::string, fixed_string> expected;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        const auto s = std::string{ keys[i].view() };
+        const auto str = out[i + 1];
+        CHECK(str.view() == s);
+        CHECK(str.c_str()[s.size()] == '\0');
+        CHECK(expected.emplace(s, str).first->second == str);
+        CHECK(pool.get_string(s) == str);
+    }
+    CHECK(pool.stats().string_count == expected.size() + 1);
+
+#if defined(LOSGODIS_STRING_POOL_STATS)
+    // one lookup per key, the misses are not looked up again
+    const std::string hit = strings[0];
+    const std::string miss = "not in the pool";
+    const string_key batch[] = { string_key{ hit }, string_key{ miss } };
+    const auto before = pool.stats();
+    out.clear();
+    pool.get_strings(batch, 2, out);
+    const auto after = pool.stats();
+    CHECK(after.lookups == before.lookups + 2);
+    CHECK(after.hits == before.hits + 1);
+#endif
+}
+
+// a hashed_string keeps the hash of its key, and containers of them can be
+// searched by key
+void hashed_strings()
+{
+    string_pool pool;
+    std::unordered_set<hashed_string> set;
+    std::unordered_set<hashed_string, string_hash, string_equal> transparent;
+    const auto strings = make_strings(5000, 20, 6);
+    for (const auto& s : strings)
+    {
+        const string_key key{ s };
+        const auto str = pool.get_hashed_string(key);
+        CHECK(str.view() == s);
+        CHECK(str.hash() == key.hash());
+        CHECK(str.key() == key);
+        CHECK(str.key().hash() == default_hash::hash(s.data(), s.size()));
+        CHECK(static_cast<fixed_string>(str) == pool.get_string(key));
+        CHECK(std::hash<hashed_string>{}(str) == key.hash());
+        CHECK(string_hash{}(str) == string_hash{}(key));
+        CHECK(string_equal{}(str, key) && string_equal{}(key, str));
+        set.insert(str);
+        transparent.insert(str);
+    }
+
+    const auto literal = pool.get_hashed_string("a literal"_key);
+    CHECK(literal.hash() == "a literal"_key.key_.hash());
+    CHECK(literal == pool.get_hashed_string(string_key{ std::string{ "a literal" } }));
+    CHECK(!string_equal{}(literal, string_key{ std::string{ "a literaL" } }));
+
+    for (const auto& s : strings)
+    {
+        const auto str = pool.get_hashed_string(string_key{ s });
+        CHECK(set.count(str) == 1);
+        CHECK(transparent.count(str) == 1);
+#if defined(__cpp_lib_generic_unordered_lookup)
+        const auto it = transparent.find(string_key{ s });
+        CHECK(it != transparent.end() && *it == str);
+#endif
+    }
+#if defined(__cpp_lib_generic_unordered_lookup)
+    CHECK(transparent.find(string_key{ std::string(30, 'z') }) == transparent.end());
+#endif
+}
+
+// wyhash final 4.2 with a seed, from wyhash.h, for the published test vectors
+uint64_t reference_wyhash(const std::string& s, uint64_t seed)
+{
+    const uint64_t secret[] = { 0x2d358dccaa6c78a5u, 0x8bb84b93962eacc9u, 0x4b33a62ed433d4a3u, 0x4d5a2da51de1aa47u };
+    const auto mum = [](uint64_t& a, uint64_t& b)
+    {
+        // in 32 bit halves, not like the pool does it
+        const uint64_t a_hi = a >> 32, a_lo = a & 0xFFFFFFFFu, b_hi = b >> 32, b_lo = b & 0xFFFFFFFFu;
+        const uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+        const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+        a = (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+        b = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    };
+    const auto mix = [&mum](uint64_t a, uint64_t b) { mum(a, b); return a ^ b; };
+    const auto byte = [&s](size_t i) { return uint64_t{ static_cast<uint8_t>(s[i]) }; };
+    const auto r4 = [&byte](size_t i) { return byte(i) | byte(i + 1) << 8 | byte(i + 2) << 16 | byte(i + 3) << 24; };
+    const auto r8 = [&r4](size_t i) { return r4(i) | r4(i + 4) << 32; };
+
+    const auto size = s.size();
+    seed ^= mix(seed ^ secret[0], secret[1]);
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (size <= 16)
+    {
+        if (size >= 4)
+        {
+            a = (r4(0) << 32) | r4((size >> 3) << 2);
+            b = (r4(size - 4) << 32) | r4(size - 4 - ((size >> 3) << 2));
+        }
+        else if (size > 0)
+        {
+            a = (byte(0) << 16) | (byte(size >> 1) << 8) | byte(size - 1);
+        }
+    }
+    else
+    {
+        size_t p = 0;
+        size_t i = size;
+        if (i >= 48)
+        {
+            uint64_t see1 = seed;
+            uint64_t see2 = seed;
+            do
+            {
+                seed = mix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+                see1 = mix(r8(p + 16) ^ secret[2], r8(p + 24) ^ see1);
+                see2 = mix(r8(p + 32) ^ secret[3], r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16)
+        {
+            seed = mix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = r8(p + i - 16);
+        b = r8(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    mum(a, b);
+    return mix(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+// the hash of a snapshot is checked when it is loaded, so the hashes can not
+// change, they are pinned by the published vectors
+void hashes()
+{
+    static_assert(sizeof(size_t) != 8 || wyhash::hash("", 0) == 0x93228a4de0eec5a2u);
+    static_assert(sizeof(size_t) != 8 || fnv1a_hash::hash("", 0) == 0xcbf29ce484222325u);
+    static_assert(sizeof(size_t) != 8 || fnv1a_hash::hash("a", 1) == 0xaf63dc4c8601ec8cu);
+    static_assert(sizeof(size_t) != 8 || fnv1a_hash::hash("foobar", 6) == 0x85944171f73967e8u);
+
+    // from test_vector.cpp of wyhash, hashed with the seed i
+    const std::pair<const char*, uint64_t> vectors[] = {
+        { "", 0x93228a4de0eec5a2u },
+        { "a", 0xc5bac3db178713c4u },
+        { "abc", 0xa97f2f7b1d9b3314u },
+        { "message digest", 0x786d1f1df3801df4u },
+        { "abcdefghijklmnopqrstuvwxyz", 0xdca5a8138ad37c87u },
+        { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 0xb9e734f117cfaf70u },
+        { "12345678901234567890123456789012345678901234567890123456789012345678901234567890", 0x6cc5eab49a92d617u } };
+    for (size_t i = 0; i < std::size(vectors); ++i)
+    {
+        CHECK(reference_wyhash(vectors[i].first, i) == vectors[i].second);
+    }
+
+    // the pool uses seed 0, every size takes one of the read paths
+    if (sizeof(size_t) == 8)
+    {
+        std::mt19937 rng{ 7 };
+        for (size_t size = 0; size < 300; ++size)
+        {
+            std::string s(size, '\0');
+            for (auto& c : s)
+            {
+                c = static_cast<char>(rng());
+            }
+            CHECK(wyhash::hash(s.data(), s.size()) == reference_wyhash(s, 0));
+        }
+    }
+
+    constexpr basic_string_key<fnv1a_hash> constant{ "constant" };
+    static_assert(constant.hash() == fnv1a_hash::hash("constant", 8));
+}
+
+// a pool works the same with the other hash policy, and its snapshots are
+// only accepted by pools of that policy
+void fnv1a_pool()
+{
+    using key = basic_string_key<fnv1a_hash>;
+    basic_string_pool<fnv1a_hash> pool{ basic_string_literal<fnv1a_hash>{ "literal"_key } };
+    std::unordered_map<std::string, fixed_string> expected;
+    for (const auto& s : make_strings(20000, 30, 8))
+    {
+        const auto str = pool.get_string(key{ s });
+        CHECK(str.view() == s);
+        CHECK(expected.emplace(s, str).first->second == str);
+    }
+    for (const auto& [s, str] : expected)
+    {
+        CHECK(pool.find(key{ s }) == str);
+    }
+    CHECK(pool.contains(key{ std::string{ "literal" } }));
+
+    std::stringstream snapshot;
+    pool.write_snapshot(snapshot);
+    const auto bytes = snapshot.str();
+    std::vector<uint64_t> words(bytes.size() / 8 + 1);
+    std::memcpy(words.data(), bytes.data(), bytes.size());
+    const string_pool_snapshot memory{ words.data(), bytes.size() };
+
+    const basic_string_pool<fnv1a_hash> loaded{ memory };
+    CHECK(loaded.find(key{ std::string{ "literal" } }).has_value());
+    bool rejected = false;
+    try
+    {
+        const string_pool other{ memory };
+    }
+    catch (const std::invalid_argument&)
+    {
+        rejected = true;
+    }
+    CHECK(rejected);
+}
+
+// the pages grow up to the biggest page size, big strings get a page of their
+// own and the current page is still filled
+void pages()
+{
+    string_pool pool{ 64, 4096 };
+    std::unordered_map<std::string, fixed_string> unique;
+    size_t bytes = 0;
+    for (const auto& s : make_strings(50000, 40, 9))
+    {
+        if (unique.emplace(s, pool.get_string(s)).second)
+        {
+            bytes += s.size() + 1;
+        }
+    }
+    auto stats = pool.stats();
+    CHECK(stats.page_bytes_used == bytes);
+    CHECK(stats.page_bytes >= bytes);
+    CHECK(stats.page_fill_ratio() > 0.9);
+
+    // a big string does not start a new page for the small ones after it
+    const auto page_count = stats.page_count;
+    const auto page_bytes = stats.page_bytes;
+    for (const auto size : { 1024, 5000, 100000 })
+    {
+        const std::string big(static_cast<size_t>(size), 'b');
+        const auto str = pool.get_string(big);
+        CHECK(str.view() == big);
+        CHECK(str.c_str()[big.size()] == '\0');
+        unique.emplace(big, str);
+    }
+    stats = pool.stats();
+    CHECK(stats.page_count == page_count + 3);
+    CHECK(stats.page_bytes == page_bytes + 1025 + 5001 + 100001);
+
+    for (const auto& [s, str] : unique)
+    {
+        CHECK(str.view() == s);
+        CHECK(pool.get_string(s) == str);
+    }
+    // a page size of 0 is one byte
+    string_pool tiny{ 0, 0 };
+    CHECK(tiny.get_string(std::string{ "tiny" }).view() == "tiny");
+    CHECK(tiny.get_string(std::string{}).view().empty());
+}
+
+// counts what it hands out, from new and delete
+class counting_resource : public std::pmr::memory_resource
+{
+
+public:
+
+    size_t allocations = 0;
+    size_t live_bytes = 0;
+
+private:
+
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        allocations++;
+        live_bytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        live_bytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
+
+// the pages and the index come from the resource of the pool and all of it is
+// given back, the default resource is not used
+void memory_resources()
+{
+    counting_resource fallback;
+    const auto previous = std::pmr::set_default_resource(&fallback);
+    {
+        counting_resource resource;
+        {
+            string_pool pool{ &resource };
+            for (const auto& s : make_strings(20000, 40, 10))
+            {
+                pool.get_string(s);
+            }
+            pool.get_string(std::string(100000, 'b'));
+            CHECK(pool.resource() == &resource);
+            CHECK(resource.allocations > 2);
+            CHECK(resource.live_bytes >= pool.stats().page_bytes);
+            pool.clear();
+            CHECK(pool.get_string(std::string{ "again" }).view() == "again");
+        }
+        CHECK(resource.live_bytes == 0);
+
+        // a per request arena that is thrown away as a whole
+        std::vector<char> buffer(1 << 20);
+        std::pmr::monotonic_buffer_resource arena{ buffer.data(), buffer.size(), &resource };
+        {
+            string_pool pool{ 256, 4096, &arena };
+            for (const auto& s : make_strings(10000, 20, 11))
+            {
+                CHECK(pool.get_string(s).view() == s);
+            }
+        }
+    }
+    std::pmr::set_default_resource(previous);
+    CHECK(fallback.allocations == 0);
+}
+
+// the sizes are always there, the lookup counters only with
+// LOSGODIS_STRING_POOL_STATS
+void stats()
+{
+    string_pool pool;
+    auto stats = pool.stats();
+    CHECK(stats.string_count == 0 && stats.string_bytes == 0 && stats.page_bytes_used == 0);
+    CHECK(stats.load_factor() == 0.0 && stats.page_fill_ratio() == 0.0);
+
+    pool.get_string(std::string{ "abc" });
+    pool.get_string(std::string{ "abc" });
+    pool.get_string("literal"_key);
+    pool.get_string(std::string(100, 'x'));
+    stats = pool.stats();
+    CHECK(stats.string_count == 3);
+    CHECK(stats.string_bytes == 3 + 7 + 100);
+    CHECK(stats.page_bytes_used == 4 + 101);
+    CHECK(stats.index_capacity >= 3);
+    CHECK(stats.load_factor() == 3.0 / static_cast<double>(stats.index_capacity));
+
+#if defined(LOSGODIS_STRING_POOL_STATS)
+    // every lookup is counted, also on an empty index
+    string_pool counted;
+    CHECK(!counted.find(std::string{ "a" }));
+    CHECK(counted.stats().lookups == 1 && counted.stats().hits == 0);
+    counted.get_string(std::string{ "a" });
+    counted.get_string(std::string{ "a" });
+    CHECK(counted.find(std::string{ "a" }));
+    stats = counted.stats();
+    CHECK(stats.lookups == 4);
+    CHECK(stats.hits == 2);
+    CHECK(stats.hit_ratio() == 0.5);
+    // an empty index has no groups to probe
+    CHECK(stats.probed_groups == 2 && stats.max_probed_groups == 1);
+#endif
+}
+
+// valid strings are pooled as get_string does, invalid ones get the error of
+// validate and nothing is added
+void get_validated_string()
+{
+    string_pool pool;
+    const std::string cases[] = {
+        "", "ascii", std::string(64, 'a'), std::string(65, 'a'), std::string(200, 'a'),
+        "caf\xC3\xA9", std::string(63, 'a') + "\xC3\xA9", std::string(100, 'a') + "\xF0\x9F\x98\x80",
+        "\x80", "ab\xC3", "\xC0\x80", std::string(70, 'a') + "\xFF", std::string(30, 'a') + "\xED\xA0", "a\xF4\x90\x80\x80" };
+    for (const auto& s : cases)
+    {
+        const auto before = pool.stats().string_count;
+        const auto result = pool.get_validated_string(s);
+        const auto expected = utf8::validate({ s.data(), s.size() });
+        CHECK(result.error == expected.error);
+        if (expected.error == utf8::validation_error::success)
+        {
+            if (CHECK(result.string))
+            {
+                CHECK(result.string->view() == s);
+                CHECK(*result.string == pool.get_string(s));
+            }
+            CHECK(result.error_offset == 0);
+        }
+        else
+        {
+            CHECK(!result.string);
+            CHECK(result.error_offset == expected.range.size());
+            CHECK(pool.stats().string_count == before);
+            CHECK(!pool.find(s));
+        }
+    }
+
+    // every offset of a short string, inside and after the inline check
+    for (size_t size = 1; size < 80; ++size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            auto s = std::string(size, 'v');
+            s[i] = '\xBF';
+            const auto result = pool.get_validated_string(s);
+            CHECK(!result.string && result.error == utf8::validation_error::unexpected_continuation_byte && result.error_offset == i);
+        }
+        CHECK(pool.get_validated_string(std::string(size, 'v')).string == pool.get_string(std::string(size, 'v')));
+    }
+}
+
+// strings around the 15 bytes kept in the index slots, that differ in one
+// byte, contain null bytes or are prefixes of each other
+void short_strings()
+{
+    string_pool pool;
+    std::unordered_map<std::string, fixed_string> expected;
+    const auto add = [&](const std::string& s)
+    {
+        const auto str = pool.get_string(s);
+        CHECK(str.view() == s);
+        CHECK(str.c_str()[s.size()] == '\0');
+        CHECK(expected.emplace(s, str).first->second == str);
+    };
+    for (size_t size = 0; size <= 20; ++size)
+    {
+        const auto base = std::string(size, 'q');
+        add(base);
+        add(base + '\0');
+        for (size_t i = 0; i < size; ++i)
+        {
+            auto s = base;
+            s[i] = 'r';
+            add(s);
+            s[i] = '\0';
+            add(s);
+            s[i] = '\xFF';
+            add(s);
+        }
+    }
+    for (const auto& [s, str] : expected)
+    {
+        CHECK(pool.get_string(s) == str);
+        CHECK(pool.find(s) == str);
+    }
+    CHECK(pool.stats().string_count == expected.size());
+}
+
+// strings added one by one and in batches while a big index grows a bit at a
+// time, all strings have to be found in the old and the new groups
+void incremental_growth()
+{
+    string_pool pool;
+    std::unordered_map<std::string, fixed_string> expected;
+    const auto strings = make_strings(300000, 30, 4);
+
+    std::vector<string_key> batch;
+    std::vector<fixed_string> out;
+    for (size_t i = 0; i < strings.size(); ++i)
+    {
+        if (i % 2 == 0)
+        {
+            const auto str = pool.get_string(strings[i]);
+            CHECK(expected.emplace(strings[i], str).first->second == str);
+        }
+        else
+        {
+            batch.emplace_back(strings[i]);
+        }
+        if (batch.size() == 1000)
+        {
+            out.clear();
+            pool.get_strings(batch.data(), batch.size(), out);
+            for (size_t k = 0; k < batch.size(); ++k)
+            {
+                const auto s = std::string{ batch[k].view() };
+                CHECK(out[k].view() == s);
+                CHECK(expected.emplace(s, out[k]).first->second == out[k]);
+            }
+            batch.clear();
+        }
+        if (i % 10007 == 0)
+        {
+            for (const auto& [s, str] : expected)
+            {
+                CHECK(pool.find(s) == str);
+            }
+        }
+    }
+    CHECK(pool.stats().string_count == expected.size());
+    for (const auto& [s, str] : expected)
+    {
+        CHECK(pool.get_string(s) == str);
+    }
+}
+
+// logs the allocations and deallocations of big blocks, which are only the
+// index when the pages are smaller
+class index_resource : public std::pmr::memory_resource
+{
+
+public:
+
+    static constexpr size_t big = 128 * 1024;
+
+    size_t allocated = 0;
+    size_t deallocated = 0;
+    size_t live = 0;
+
+private:
+
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (bytes >= big)
+        {
+            allocated++;
+            live++;
+        }
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        if (bytes >= big)
+        {
+            deallocated++;
+            live--;
+        }
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
+
+// no single get_string allocates the new groups and frees the old ones, also
+// after reserve and clear
+void growth_without_rehash()
+{
+    index_resource resource;
+    string_pool pool{ 4096, 64 * 1024, &resource };
+    const auto strings = make_strings(400000, 30, 12);
+    size_t blocking = 0;
+    for (size_t i = 0; i < strings.size(); ++i)
+    {
+        if (i == 50000 || i == 150000)
+        {
+            pool.reserve(pool.stats().string_count + 1000);
+        }
+        if (i == 250000)
+        {
+            pool.clear();
+        }
+        const auto allocated = resource.allocated;
+        const auto deallocated = resource.deallocated;
+        pool.get_string(strings[i]);
+        blocking += resource.allocated != allocated && resource.deallocated != deallocated;
+    }
+    CHECK(blocking == 0);
+    CHECK(resource.allocated > 3);
+
+    // a clear in the middle of moving the strings frees the old groups
+    const auto allocated = resource.allocated;
+    size_t added = pool.stats().string_count;
+    while (resource.allocated == allocated || resource.live == 1)
+    {
+        pool.get_string("more " + std::to_string(added++));
+    }
+    CHECK(resource.live == 2);
+    pool.clear();
+    CHECK(resource.live == 1);
+    CHECK(pool.stats().string_count == 0);
+    CHECK(!pool.find(strings[0]));
+    CHECK(pool.get_string(strings[0]).view() == strings[0]);
+}
+
+// a cleared pool is filled again with the pages and index it already has
+void clear_and_refill()
+{
+    string_pool pool{ 256 };
+    pool_stats first;
+    for (int round = 0; round < 5; ++round)
+    {
+        std::vector<std::pair<std::string, fixed_string>> added;
+        for (int i = 0; i < 50000; ++i)
+        {
+            const auto s = "r" + std::to_string(round) + "_" + std::to_string(i * 7 % 40000);
+            added.emplace_back(s, pool.get_string(s));
+        }
+        const std::string big(5000, 'B');
+        added.emplace_back(big, pool.get_string(big));
+        for (const auto& [s, str] : added)
+        {
+            CHECK(str.view() == s);
+            CHECK(pool.get_string(s) == str);
+        }
+
+        const auto stats = pool.stats();
+        CHECK(stats.string_count == 40001);
+        if (round == 0)
+        {
+            first = stats;
+        }
+        else
+        {
+            CHECK(stats.page_count == first.page_count);
+            CHECK(stats.page_bytes == first.page_bytes);
+            CHECK(stats.index_capacity == first.index_capacity);
+        }
+
+        pool.clear();
+        const auto cleared = pool.stats();
+        CHECK(cleared.string_count == 0);
+        CHECK(cleared.string_bytes == 0);
+        CHECK(cleared.page_bytes_used == 0);
+        CHECK(cleared.index_capacity == first.index_capacity);
+        CHECK(pool.get_string(std::string{ "r0_1" }).view() == "r0_1");
+        pool.clear();
+    }
+}
+
+// a thread_cache does not return strings from before its pool was cleared or
+// merged into another one, the old data is freed or holds other strings
+void thread_cache_after_clear()
+{
+    string_pool pool{ 64, 1024 };
+    thread_cache<string_pool> cache{ pool };
+    const std::string big(5000, 'B');
+    for (int round = 0; round < 3; ++round)
+    {
+        CHECK(pool.clear_count() == static_cast<uint64_t>(round));
+        std::vector<std::string> strings;
+        for (int i = 0; i < 100; ++i)
+        {
+            strings.push_back(std::to_string(round) + " cached " + std::to_string(i));
+        }
+        const auto cached = cache.get_string(big);
+        CHECK(cached == pool.get_string(big));
+        for (const auto& s : strings)
+        {
+            CHECK(cache.get_string(s) == pool.get_string(s));
+        }
+
+        // the kept pages are filled again with other strings
+        pool.clear();
+        for (int i = 0; i < 100; ++i)
+        {
+            pool.get_string("refill " + std::to_string(i));
+        }
+        CHECK(cache.get_string(big) == pool.get_string(big));
+        for (const auto& s : strings)
+        {
+            const auto str = cache.get_string(s);
+            CHECK(str.view() == s);
+            CHECK(str == pool.get_string(s));
+        }
+    }
+
+    string_pool other;
+    thread_cache<string_pool> other_cache{ other };
+    const auto str = other_cache.get_string(std::string{ "merged" });
+    pool.merge(std::move(other));
+    CHECK(other.clear_count() == 1);
+    CHECK(pool.get_string(std::string{ "merged" }) == str);
+    CHECK(other_cache.get_string(std::string{ "merged" }) == other.get_string(std::string{ "merged" }));
+}
+
+// a frozen pool finds every string in its snapshot, also after it is moved
+void freeze()
+{
+    string_pool pool{ "if"_key, "else"_key };
+    const auto strings = make_strings(20000, 30, 2);
+    for (const auto& s : strings)
+    {
+        pool.get_string(s);
+    }
+
+    std::optional<frozen_string_pool> moved;
+    {
+        auto frozen = pool.freeze();
+        CHECK(frozen.stats().string_count == pool.stats().string_count);
+        moved.emplace(std::move(frozen));
+    }
+    const auto& frozen = *moved;
+    const auto snapshot = frozen.snapshot();
+    for (const auto& s : strings)
+    {
+        const auto str = frozen.find(s);
+        if (CHECK(str))
+        {
+            CHECK(str->view() == s);
+            CHECK(str->data() >= static_cast<const char*>(snapshot.data));
+            CHECK(str->data() < static_cast<const char*>(snapshot.data) + snapshot.size);
+        }
+    }
+    CHECK(frozen.contains("else"_key));
+    CHECK(!frozen.find(std::string(40, 'z')));
+
+    // a pool made from the frozen snapshot uses its strings in place
+    string_pool from_snapshot{ frozen.snapshot() };
+    for (const auto& s : strings)
+    {
+        CHECK(from_snapshot.get_string(s).data() == frozen.find(s)->data());
+    }
+}
+
+// pools merged into one give it their pages, their strings are found in it
+void merge()
+{
+    std::vector<string_pool> parts(4);
+    std::vector<std::vector<std::pair<std::string, fixed_string>>> added(parts.size());
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        for (const auto& s : make_strings(10000, 20, static_cast<uint32_t>(10 + i)))
+        {
+            added[i].emplace_back(s, parts[i].get_string(s));
+        }
+    }
+
+    string_pool merged;
+    const auto kept = merged.get_string(added[1][0].first);
+    for (auto& part : parts)
+    {
+        merged.merge(std::move(part));
+        CHECK(part.stats().string_count == 0);
+    }
+    parts.clear();
+
+    // the fixed_strings of the merged pools are still valid, a string that was
+    // already in the pool keeps its fixed_string
+    std::unordered_map<std::string, fixed_string> expected;
+    for (const auto& part : added)
+    {
+        for (const auto& [s, str] : part)
+        {
+            CHECK(std::strcmp(str.c_str(), s.c_str()) == 0);
+            const auto found = merged.get_string(s);
+            CHECK(found.view() == s);
+            CHECK(expected.emplace(s, found).first->second == found);
+        }
+    }
+    CHECK(merged.get_string(added[1][0].first) == kept);
+    CHECK(merged.stats().string_count == expected.size());
+}
+
+// find and find_many look strings up in the pool and never add one
+void find()
+{
+    string_pool pool;
+    const auto strings = make_strings(20000, 30, 3);
+    for (size_t i = 0; i < strings.size(); i += 2)
+    {
+        pool.get_string(strings[i]);
+    }
+    const auto before = pool.stats();
+
+    std::vector<string_key> keys;
+    for (const auto& s : strings)
+    {
+        keys.emplace_back(s);
+    }
+    std::vector<std::optional<fixed_string>> found;
+    pool.find_many(keys.data(), keys.size(), found);
+    CHECK(found.size() == keys.size());
+
+    for (size_t i = 0; i < strings.size(); ++i)
+    {
+        const auto str = pool.find(strings[i]);
+        // the odd ones can also be duplicates of an even one
+        if (i % 2 == 0 && !CHECK(str))
+        {
+            continue;
+        }
+        if (str)
+        {
+            CHECK(str->view() == strings[i]);
+            CHECK(found[i] && *found[i] == *str);
+        }
+        else
+        {
+            CHECK(!found[i]);
+        }
+    }
+
+    const auto after = pool.stats();
+    CHECK(after.string_count == before.string_count);
+    CHECK(after.page_bytes_used == before.page_bytes_used);
+    CHECK(after.index_capacity == before.index_capacity);
+}
+
+} // namespace
+
+int main()
+{
+    get_string();
+    get_strings();
+    hashed_strings();
+    hashes();
+    fnv1a_pool();
+    pages();
+    memory_resources();
+    stats();
+    get_validated_string();
+    short_strings();
+    incremental_growth();
+    growth_without_rehash();
+    clear_and_refill();
+    thread_cache_after_clear();
+    freeze();
+    merge();
+    find();
+    return test::exit_code();
+}
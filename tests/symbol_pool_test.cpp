@@ -0,0 +1,190 @@
+
+#include "check.hpp"
+
+#include "losgodis/symbol_pool.hpp"
+
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace losgodis;
+
+namespace
+{
+
+// every string gets one symbol, the ids are dense in the order the strings
+// were first added
+void interning()
+{
+    symbol_pool pool;
+    std::unordered_map<std::string, symbol> expected;
+    std::vector<std::string> by_id;
+    for (int i = 0; i < 50000; ++i)
+    {
+        const auto s = std::string(static_cast<size_t>(i % 7 * 5), 's') + std::to_string(i * 7 % 30000);
+        const auto sym = pool.get_symbol(s);
+        const auto [it, added] = expected.emplace(s, sym);
+        CHECK(it->second == sym);
+        if (added)
+        {
+            CHECK(sym.id() == by_id.size());
+            by_id.push_back(s);
+        }
+    }
+    CHECK(pool.size() == by_id.size());
+    CHECK(pool.get_symbol(""_key).id() == by_id.size());
+    CHECK(pool.get_symbol(std::string{}) == pool.get_symbol(""_key));
+    CHECK(pool.get_symbol(std::string_view{ "s0" }) == pool.get_symbol(std::string{ "s0" }));
+}
+
+void find()
+{
+    symbol_pool pool;
+    const auto a = pool.get_symbol("alpha"_key);
+    const auto b = pool.get_symbol(std::string{ "beta" });
+
+    CHECK(pool.find("alpha"_key) == a);
+    CHECK(pool.find(std::string_view{ "beta" }) == b);
+    CHECK(pool.find(std::string{ "beta" }) == b);
+    CHECK(pool.find(string_key{ std::string{ "alpha" } }) == a);
+    CHECK(!pool.find(std::string{ "gamma" }).valid());
+    CHECK(!pool.find(std::string{ "alph" }).valid());
+    CHECK(pool.size() == 2);
+
+    // not on an empty pool either
+    const symbol_pool empty;
+    CHECK(!empty.find("alpha"_key).valid());
+    CHECK(!symbol{}.valid());
+}
+
+// view, c_str and str give the string of a symbol, the views of the old
+// symbols are valid again after more are added
+void views()
+{
+    symbol_pool pool;
+    std::vector<std::pair<symbol, std::string>> added;
+    for (int i = 0; i < 10000; ++i)
+    {
+        const auto s = "view " + std::to_string(i) + std::string(static_cast<size_t>(i % 50), 'v');
+        added.emplace_back(pool.get_symbol(s), s);
+    }
+    for (const auto& [sym, s] : added)
+    {
+        CHECK(pool.view(sym) == s);
+        CHECK(std::strcmp(pool.c_str(sym), s.c_str()) == 0);
+        CHECK(pool.str(sym) == s);
+    }
+    const auto empty = pool.get_symbol(std::string{});
+    CHECK(pool.view(empty).empty());
+    CHECK(*pool.c_str(empty) == '\0');
+}
+
+// from new and delete until failing is set
+class failing_resource : public std::pmr::memory_resource
+{
+
+public:
+
+    bool failing = false;
+
+private:
+
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (failing)
+        {
+            throw std::bad_alloc{};
+        }
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override { std::pmr::new_delete_resource()->deallocate(p, bytes, alignment); }
+    bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
+
+std::string grow_string(size_t i)
+{
+    return "grow " + std::to_string(i);
+}
+
+// all symbols added so far are there
+bool complete(const symbol_pool& pool, size_t count)
+{
+    bool ok = pool.size() == count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ok = ok && pool.find(grow_string(i)).id() == i && pool.view(symbol{ static_cast<uint32_t>(i) }) == grow_string(i);
+    }
+    return ok;
+}
+
+// the index grows and can be reserved, a growth that fails leaves the pool
+// as it was
+void growth()
+{
+    symbol_pool pool;
+    pool.reserve(1000, 10000);
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        CHECK(pool.get_symbol(grow_string(i)).id() == i);
+    }
+    CHECK(complete(pool, 100000));
+
+    // 896 symbols fill 128 groups, the next one grows the index first
+    failing_resource resource;
+    symbol_pool index_full{ &resource };
+    index_full.reserve(896, 896 * 16);
+    resource.failing = true;
+    for (size_t i = 0; i < 896; ++i)
+    {
+        index_full.get_symbol(grow_string(i));
+    }
+    bool thrown = false;
+    try
+    {
+        index_full.get_symbol(grow_string(896));
+    }
+    catch (const std::bad_alloc&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(complete(index_full, 896));
+    resource.failing = false;
+    CHECK(index_full.get_symbol(grow_string(896)).id() == 896);
+    CHECK(complete(index_full, 897));
+
+    // room in the index but not for the strings
+    symbol_pool chars_full{ &resource };
+    chars_full.reserve(896, 0);
+    resource.failing = true;
+    size_t count = 0;
+    try
+    {
+        for (; count < 896; ++count)
+        {
+            chars_full.get_symbol(grow_string(count));
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+    }
+    CHECK(count < 896);
+    CHECK(complete(chars_full, count));
+    resource.failing = false;
+    CHECK(chars_full.get_symbol(grow_string(count)).id() == count);
+    CHECK(complete(chars_full, count + 1));
+}
+
+} // namespace
+
+int main()
+{
+    interning();
+    find();
+    views();
+    growth();
+    return test::exit_code();
+}
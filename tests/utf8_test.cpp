@@ -0,0 +1,359 @@
+
+#include "check.hpp"
+
+#include "losgodis/utf8.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace losgodis;
+using namespace losgodis::utf8;
+
+namespace
+{
+
+struct expected_result
+{
+    validation_error error;
+    size_t           end;
+    size_t           codepoint_count;
+};
+
+// The validation rules one codepoint at a time, what the simd kernels and the
+// other validators have to agree with. Like validate, a two byte 0x7F is not
+// flagged as overlong.
+expected_result reference_validate(const std::string& s, bool quick)
+{
+    const auto byte = [&](size_t i) { return static_cast<uint8_t>(s[i]); };
+    const auto error = [](validation_error e, size_t i, size_t count) { return expected_result{ e, i, count }; };
+
+    size_t count = 0;
+    size_t i = 0;
+    while (i < s.size())
+    {
+        const auto b1 = byte(i);
+        size_t length;
+        if (b1 < 0x80u) { length = 1; }
+        else if (b1 < 0xC0u) { return error(validation_error::unexpected_continuation_byte, i, count); }
+        else if (b1 < 0xE0u) { length = 2; }
+        else if (b1 < 0xF0u) { length = 3; }
+        else if (b1 < 0xF8u) { length = 4; }
+        else { return error(validation_error::invalid_byte, i, count); }
+
+        if (i + length > s.size()) { return error(validation_error::unexpected_end, i, count); }
+
+        uint32_t codepoint = length == 1 ? b1 : b1 & (0x7Fu >> length);
+        for (size_t k = 1; k < length; ++k)
+        {
+            if ((byte(i + k) & 0xC0u) != 0x80u) { return error(validation_error::unexpected_non_continuation_byte, i, count); }
+            codepoint = (codepoint << 6) | (byte(i + k) & 0x3Fu);
+        }
+
+        if (!quick)
+        {
+            if (length == 4 && codepoint > 0x10FFFFu) { return error(validation_error::invalid_codepoint, i, count); }
+            const uint32_t smallest[] = { 0, 0, 0x7F, 0x800, 0x10000 };
+            if (codepoint < smallest[length]) { return error(validation_error::overlong_enocoding, i, count); }
+        }
+
+        i += length;
+        count++;
+    }
+    return { validation_error::success, i, count };
+}
+
+// mostly ascii with codepoints, invalid sequences and cut ones mixed in, so
+// the errors land anywhere in and across the 64 byte blocks
+std::string make_text(std::mt19937& rng, size_t size)
+{
+    static const char* const pieces[] = {
+        "\xC3\xA9", "\xE4\xB8\xAD", "\xF0\x9F\x98\x80", "\xF4\x8F\xBF\xBF", "\xEF\xBF\xBF", "\xDF\xBF", "\xC2\x80",
+        "\xED\xA0\x80", "\xE0\xA0\x80", "\xF0\x90\x80\x80",
+        "\xC1\xBF", "\xC0\x80", "\xE0\x80\x80", "\xF0\x80\x80\x80", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80",
+        "\xF8", "\xFF", "\x80", "\xF0", "\xE2", "\xC3" };
+    const auto piece_count = std::size(pieces);
+    const auto valid_count = 10u;
+
+    // some texts are valid all the way, the others have an error now and then
+    const auto valid = rng() % 3 == 0;
+    const auto density = 1 + rng() % 200;
+
+    std::string s;
+    while (s.size() < size)
+    {
+        if (rng() % 1000 >= density)
+        {
+            s += static_cast<char>('a' + rng() % 26);
+        }
+        else
+        {
+            s += pieces[rng() % (valid ? valid_count : piece_count)];
+        }
+    }
+    s.resize(size);
+    return s;
+}
+
+bool same(const validation_result& result, const expected_result& expected)
+{
+    return result.error == expected.error && result.range.size() == expected.end && result.codepoint_count == expected.codepoint_count;
+}
+
+void check_validate(const std::string& s)
+{
+    const byte_range range{ s.data(), s.size() };
+    const auto expected = reference_validate(s, false);
+    CHECK(same(validate(range), expected));
+    CHECK(same(validate_quick(range), reference_validate(s, true)));
+    if (expected.error == validation_error::success)
+    {
+        CHECK(count_codepoints(utf8_range{ s.data(), s.size() }) == expected.codepoint_count);
+    }
+}
+
+// chunks of 64 bytes and up, so the last chunk is often a short one
+void check_parallel(const std::string& s, std::mt19937& rng)
+{
+    const executor inline_executor = [](std::function<void()> task) { task(); };
+    const byte_range range{ s.data(), s.size() };
+    const auto chunk_size = size_t{ 64 } << rng() % 4;
+    CHECK(same(validate_parallel(range, inline_executor, chunk_size), reference_validate(s, false)));
+}
+
+// fed in pieces of up to 100 bytes, so the codepoints are cut everywhere
+void check_stream(const std::string& s, std::mt19937& rng)
+{
+    for (const auto quick : { false, true })
+    {
+        stream_validator validator{ quick };
+        for (size_t i = 0; i < s.size();)
+        {
+            const auto n = std::min<size_t>(1 + rng() % 100, s.size() - i);
+            validator.feed({ s.data() + i, n });
+            i += n;
+        }
+        const auto result = validator.finish();
+        const auto expected = reference_validate(s, quick);
+        CHECK(result.error == expected.error && result.byte_count == expected.end && result.codepoint_count == expected.codepoint_count);
+    }
+}
+
+void random_texts()
+{
+    std::mt19937 rng{ 1 };
+    for (int i = 0; i < 20000; ++i)
+    {
+        const auto s = make_text(rng, rng() % 700);
+        check_validate(s);
+        check_parallel(s, rng);
+        check_stream(s, rng);
+    }
+    for (int i = 0; i < 20; ++i)
+    {
+        const auto s = make_text(rng, 100000 + rng() % 100000);
+        check_validate(s);
+        check_parallel(s, rng);
+    }
+}
+
+// an ascii run of every length up to a few words, and then a codepoint, an
+// error or the end, so the run ends at every offset in a word and a block
+void ascii_runs()
+{
+    for (const auto tail : { "", "\xC3\xA9", "\xF0\x9F\x98\x80", "\x80", "\xC3", "\xE0\x80\x80", "\xFF" })
+    {
+        for (size_t size = 0; size < 300; ++size)
+        {
+            const auto s = std::string(size, 'a') + tail + std::string(size % 70, 'b');
+            check_validate(s);
+        }
+    }
+    // a byte with the high bit set at every offset of a long ascii text
+    for (size_t i = 0; i < 300; ++i)
+    {
+        auto s = std::string(300, 'x');
+        s[i] = '\x80';
+        check_validate(s);
+        s[i] = '\x7F';
+        check_validate(s);
+    }
+}
+
+// a final chunk of a few bytes after a lead byte near the chunk boundary, so
+// the cut codepoint may or may not run past the end
+void short_final_chunks()
+{
+    const executor inline_executor = [](std::function<void()> task) { task(); };
+    const char leads[] = { '\xC3', '\xE2', '\xF0', '\xF4' };
+    const char tails[] = { 'A', '\x80', '\xBF' };
+
+    std::mt19937 rng{ 3 };
+    for (int i = 0; i < 20000; ++i)
+    {
+        auto s = make_text(rng, 64 * (1 + rng() % 8));
+        s[s.size() - 1 - rng() % 3] = leads[rng() % std::size(leads)];
+        for (auto n = 1 + rng() % 4; n > 0; --n)
+        {
+            s += tails[rng() % std::size(tails)];
+        }
+        CHECK(same(validate_parallel({ s.data(), s.size() }, inline_executor, 64), reference_validate(s, false)));
+    }
+}
+
+// a codepoint cut by a chunk boundary that also runs past the end
+void parallel_cut_at_end()
+{
+    const executor inline_executor = [](std::function<void()> task) { task(); };
+    for (const auto lead : { "\xF0", "\xE2", "\xF0\x9F", "\xC3" })
+    {
+        for (const auto tail : { "A", "AB", "\x80", "" })
+        {
+            for (size_t prefix = 120; prefix < 130; ++prefix)
+            {
+                const auto s = std::string(prefix, 'a') + lead + tail;
+                CHECK(same(validate_parallel({ s.data(), s.size() }, inline_executor, 64), reference_validate(s, false)));
+            }
+        }
+    }
+}
+
+void parallel_threads()
+{
+    // every chunk on a thread of its own, joined after validate_parallel returns
+    std::vector<std::thread> threads;
+    const executor thread_executor = [&](std::function<void()> task) { threads.emplace_back(std::move(task)); };
+
+    std::mt19937 rng{ 2 };
+    for (int i = 0; i < 50; ++i)
+    {
+        const auto s = make_text(rng, 1000 + rng() % 5000);
+        CHECK(same(validate_parallel({ s.data(), s.size() }, thread_executor, 256), reference_validate(s, false)));
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        threads.clear();
+    }
+}
+
+// the codepoints of a valid text
+std::vector<codepoint_t> reference_decode(const std::string& s)
+{
+    std::vector<codepoint_t> codepoints;
+    for (size_t i = 0; i < s.size();)
+    {
+        const auto b1 = static_cast<uint8_t>(s[i]);
+        const size_t length = b1 < 0x80u ? 1 : b1 < 0xE0u ? 2 : b1 < 0xF0u ? 3 : 4;
+        codepoint_t codepoint = length == 1 ? b1 : b1 & (0x7Fu >> length);
+        for (size_t k = 1; k < length; ++k)
+        {
+            codepoint = (codepoint << 6) | (static_cast<uint8_t>(s[i + k]) & 0x3Fu);
+        }
+        codepoints.push_back(codepoint);
+        i += length;
+    }
+    return codepoints;
+}
+
+std::string make_valid_text(std::mt19937& rng, size_t size)
+{
+    std::string s;
+    while (s.empty() || validate({ s.data(), s.size() }).error != validation_error::success)
+    {
+        s = make_text(rng, size);
+    }
+    return s;
+}
+
+// forward and backward over valid texts, and at / substr with and without a
+// codepoint_index
+void iteration()
+{
+    std::mt19937 rng{ 4 };
+    for (int i = 0; i < 2000; ++i)
+    {
+        const auto s = make_valid_text(rng, 1 + rng() % 300);
+        const auto range = validate({ s.data(), s.size() }).range;
+        const auto expected = reference_decode(s);
+
+        const std::vector<codepoint_t> forward(range.begin(), range.end());
+        CHECK(forward == expected);
+        CHECK(range.codepoint_count() == expected.size());
+
+        std::vector<codepoint_t> backward;
+        for (auto it = range.end(); it != range.begin();)
+        {
+            backward.push_back(*--it);
+        }
+        std::reverse(backward.begin(), backward.end());
+        CHECK(backward == expected);
+
+        const codepoint_index index{ range };
+        for (size_t n = 0; n < expected.size(); n += 1 + rng() % 5)
+        {
+            CHECK(range.at(n) == expected[n] && index.at(n) == expected[n]);
+            const auto count = rng() % 20;
+            const auto a = range.substr(n, count);
+            const auto b = index.substr(n, count);
+            CHECK(a.data() == b.data() && a.size() == b.size());
+            CHECK(std::vector<codepoint_t>(a.begin(), a.end()) == std::vector<codepoint_t>(expected.begin() + n, expected.begin() + std::min(n + count, expected.size())));
+        }
+    }
+}
+
+// next decodes what the reference does and stops at the end
+void next()
+{
+    std::mt19937 rng{ 5 };
+    for (int i = 0; i < 2000; ++i)
+    {
+        const auto s = make_valid_text(rng, 1 + rng() % 300);
+        const auto range = utf8_range{ s.data(), s.size() };
+        std::vector<codepoint_t> decoded;
+        for (auto it = range.begin(); it != range.end();)
+        {
+            codepoint_t codepoint;
+            it.next(codepoint);
+            decoded.push_back(codepoint);
+        }
+        CHECK(decoded == reference_decode(s));
+    }
+}
+
+#if defined(NDEBUG)
+// a stray byte on invalid utf8 is stepped over on its own, with asserts the
+// iterator does not accept it
+void invalid_iteration()
+{
+    for (const auto stray : { "\x80", "\xBF", "\xF8", "\xFF" })
+    {
+        const auto s = std::string{ "a" } + stray + "bcd";
+        iterator it{ s.data() + 1 };
+        ++it;
+        CHECK(it.data() == s.data() + 2);
+        codepoint_t codepoint;
+        CHECK((iterator{ s.data() + 1 }.next(codepoint).data() == s.data() + 2));
+    }
+}
+#endif
+
+} // namespace
+
+int main()
+{
+    random_texts();
+    ascii_runs();
+    short_final_chunks();
+    parallel_cut_at_end();
+    parallel_threads();
+    iteration();
+    next();
+#if defined(NDEBUG)
+    invalid_iteration();
+#endif
+    return test::exit_code();
+}
@@ -0,0 +1,239 @@
+
+#include "check.hpp"
+
+#include "losgodis/utf8_transcode.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace losgodis;
+using namespace losgodis::utf8;
+
+namespace
+{
+
+void append_utf8(std::string& s, codepoint_t codepoint)
+{
+    if (codepoint < 0x80u)
+    {
+        s += static_cast<char>(codepoint);
+    }
+    else if (codepoint < 0x800u)
+    {
+        s += static_cast<char>(0xC0u | (codepoint >> 6));
+        s += static_cast<char>(0x80u | (codepoint & 0x3Fu));
+    }
+    else if (codepoint < 0x10000u)
+    {
+        s += static_cast<char>(0xE0u | (codepoint >> 12));
+        s += static_cast<char>(0x80u | ((codepoint >> 6) & 0x3Fu));
+        s += static_cast<char>(0x80u | (codepoint & 0x3Fu));
+    }
+    else
+    {
+        s += static_cast<char>(0xF0u | (codepoint >> 18));
+        s += static_cast<char>(0x80u | ((codepoint >> 12) & 0x3Fu));
+        s += static_cast<char>(0x80u | ((codepoint >> 6) & 0x3Fu));
+        s += static_cast<char>(0x80u | (codepoint & 0x3Fu));
+    }
+}
+
+void append_utf16(std::u16string& s, codepoint_t codepoint)
+{
+    if (codepoint < 0x10000u)
+    {
+        s += static_cast<char16_t>(codepoint);
+    }
+    else
+    {
+        s += static_cast<char16_t>(0xD800u + ((codepoint - 0x10000u) >> 10));
+        s += static_cast<char16_t>(0xDC00u + ((codepoint - 0x10000u) & 0x3FFu));
+    }
+}
+
+// mostly ascii runs, so the 8 byte ascii loops run too, and codepoints of
+// every length but no surrogates, they do not survive a round trip
+std::vector<codepoint_t> make_codepoints(std::mt19937& rng, size_t count)
+{
+    std::vector<codepoint_t> codepoints;
+    while (codepoints.size() < count)
+    {
+        switch (rng() % 5)
+        {
+        case 0: codepoints.push_back(0x80u + rng() % (0x800u - 0x80u)); break;
+        case 1: codepoints.push_back(0x800u + rng() % (0xD800u - 0x800u)); break;
+        case 2: codepoints.push_back(0xE000u + rng() % (0x10000u - 0xE000u)); break;
+        case 3: codepoints.push_back(0x10000u + rng() % (0x110000u - 0x10000u)); break;
+        default:
+            for (auto n = rng() % 40; n > 0; --n)
+            {
+                codepoints.push_back(rng() % 0x80u);
+            }
+        }
+    }
+    codepoints.resize(count);
+    return codepoints;
+}
+
+// utf8 decodes to the codepoints and they encode to the same utf8 again,
+// through utf32 and utf16
+void round_trips()
+{
+    std::mt19937 rng{ 1 };
+    for (int i = 0; i < 3000; ++i)
+    {
+        const auto codepoints = make_codepoints(rng, rng() % (i < 2990 ? 300 : 50000));
+        std::string s;
+        std::u16string utf16;
+        for (const auto codepoint : codepoints)
+        {
+            append_utf8(s, codepoint);
+            append_utf16(utf16, codepoint);
+        }
+
+        const auto validated = validate({ s.data(), s.size() });
+        if (!CHECK(validated.error == validation_error::success))
+        {
+            continue;
+        }
+        const auto range = validated.range;
+
+        std::vector<codepoint_t> decoded32(codepoints.size());
+        CHECK(decode_to_utf32(range, decoded32.data()) == codepoints.size());
+        CHECK(decoded32 == codepoints);
+
+        CHECK(utf16_length(range) == utf16.size());
+        std::u16string decoded16(utf16.size(), u'\0');
+        CHECK(decode_to_utf16(range, decoded16.data()) == utf16.size());
+        CHECK(decoded16 == utf16);
+
+        std::vector<codepoint_t> validated32(s.size());
+        const auto result32 = validate_to_utf32({ s.data(), s.size() }, validated32.data());
+        CHECK(result32.error == validation_error::success && result32.byte_count == s.size() && result32.written == codepoints.size());
+        validated32.resize(codepoints.size());
+        CHECK(validated32 == codepoints);
+
+        std::u16string validated16(s.size(), u'\0');
+        const auto result16 = validate_to_utf16({ s.data(), s.size() }, validated16.data());
+        CHECK(result16.error == validation_error::success && result16.byte_count == s.size() && result16.written == utf16.size());
+        validated16.resize(utf16.size());
+        CHECK(validated16 == utf16);
+
+        CHECK(utf8_length(codepoints.data(), codepoints.size()) == s.size());
+        std::string encoded32(s.size(), '\0');
+        CHECK(encode_utf8(codepoints.data(), codepoints.size(), encoded32.data()) == s.size());
+        CHECK(encoded32 == s);
+
+        CHECK(utf8_length(utf16.data(), utf16.size()) == s.size());
+        std::string encoded16(s.size(), '\0');
+        CHECK(encode_utf8(utf16.data(), utf16.size(), encoded16.data()) == s.size());
+        CHECK(encoded16 == s);
+    }
+}
+
+void surrogate_pairs()
+{
+    const std::u16string expected = u"a\U00010000\U0001F600\U0010FFFF";
+    CHECK(expected == (std::u16string{ u'a', 0xD800, 0xDC00, 0xD83D, 0xDE00, 0xDBFF, 0xDFFF }));
+
+    const std::string s = "a\xF0\x90\x80\x80\xF0\x9F\x98\x80\xF4\x8F\xBF\xBF";
+    const auto range = validate({ s.data(), s.size() }).range;
+    CHECK(utf16_length(range) == expected.size());
+    std::u16string decoded(expected.size(), u'\0');
+    CHECK(decode_to_utf16(range, decoded.data()) == expected.size());
+    CHECK(decoded == expected);
+
+    std::string encoded(utf8_length(expected.data(), expected.size()), '\0');
+    CHECK(encode_utf8(expected.data(), expected.size(), encoded.data()) == s.size());
+    CHECK(encoded == s);
+}
+
+// unpaired surrogates and values above 0x10FFFF are encoded as U+FFFD
+void replacement()
+{
+    const std::string fffd = "\xEF\xBF\xBD";
+    const auto encode16 = [](const std::u16string& in)
+    {
+        std::string out(utf8_length(in.data(), in.size()), '\0');
+        out.resize(encode_utf8(in.data(), in.size(), out.data()));
+        return out;
+    };
+    const auto encode32 = [](const std::vector<codepoint_t>& in)
+    {
+        std::string out(utf8_length(in.data(), in.size()), '\0');
+        out.resize(encode_utf8(in.data(), in.size(), out.data()));
+        return out;
+    };
+
+    CHECK(encode16({ 0xD800 }) == fffd);
+    CHECK(encode16({ 0xDC00 }) == fffd);
+    CHECK(encode16({ 0xD800, u'a' }) == fffd + "a");
+    CHECK(encode16({ u'a', 0xDFFF }) == "a" + fffd);
+    CHECK(encode16({ 0xDC00, 0xD800 }) == fffd + fffd);
+    CHECK(encode16({ 0xD800, 0xD800, 0xDC00 }) == fffd + "\xF0\x90\x80\x80");
+
+    CHECK(encode32({ 0xD800 }) == fffd);
+    CHECK(encode32({ 0xDFFF, u'b' }) == fffd + "b");
+    CHECK(encode32({ 0x110000 }) == fffd);
+    CHECK(encode32({ 0xFFFFFFFF, 0x10FFFF }) == fffd + "\xF4\x8F\xBF\xBF");
+}
+
+// on error everything before the first problematic byte is decoded, and the
+// offset and error are the ones of validate, also across the chunks
+void validate_errors()
+{
+    static const char* const errors[] = { "\x80", "\xC3", "\xC3" "A", "\xE2\x82", "\xC0\x80", "\xED\xBF\xBF\xF4\x90\x80\x80", "\xFF", "\xF0\x9F\x98" };
+
+    std::mt19937 rng{ 2 };
+    for (int i = 0; i < 2000; ++i)
+    {
+        std::string s;
+        for (const auto codepoint : make_codepoints(rng, rng() % 200))
+        {
+            append_utf8(s, codepoint);
+        }
+        // some right before the end of a 16 KiB chunk
+        if (i % 10 == 0)
+        {
+            s = std::string(16 * 1024 - 1 - rng() % 4, 'x') + s;
+        }
+        s.insert(rng() % (s.size() + 1), errors[rng() % std::size(errors)]);
+        if (rng() % 2 == 0)
+        {
+            s.append(rng() % 100, 'y');
+        }
+
+        const auto expected = validate({ s.data(), s.size() });
+
+        std::vector<codepoint_t> decoded32(s.size());
+        const auto result32 = validate_to_utf32({ s.data(), s.size() }, decoded32.data());
+        CHECK(result32.error == expected.error);
+        CHECK(result32.byte_count == expected.range.size());
+        CHECK(result32.written == expected.codepoint_count);
+        std::vector<codepoint_t> prefix32(expected.codepoint_count);
+        decode_to_utf32(expected.range, prefix32.data());
+        decoded32.resize(result32.written);
+        CHECK(decoded32 == prefix32);
+
+        std::u16string decoded16(s.size(), u'\0');
+        const auto result16 = validate_to_utf16({ s.data(), s.size() }, decoded16.data());
+        CHECK(result16.error == expected.error);
+        CHECK(result16.byte_count == expected.range.size());
+        std::u16string prefix16(utf16_length(expected.range), u'\0');
+        decode_to_utf16(expected.range, prefix16.data());
+        decoded16.resize(result16.written);
+        CHECK(decoded16 == prefix16);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    round_trips();
+    surrogate_pairs();
+    replacement();
+    validate_errors();
+    return test::exit_code();
+}